@@ -32,6 +32,7 @@
 # define DESKTOP_MIXER_CONTROL_H
 
 # include <stdarg.h>
+# include <stdint.h>
 # include <gtk/gtk.h>
 # include <System/string.h>
 
@@ -65,4 +66,44 @@ typedef struct _MixerControlDefinition
 	int (*set)(MixerControlPlugin * plugin, va_list properties);
 } MixerControlDefinition;
 
+
+/* version 2, exported as "control2" */
+# define MIXERCONTROL_VERSION	2
+
+typedef enum _MixerControlProperty
+{
+	MCP_BIND = 0,	/* gboolean */
+	MCP_CHANNELS,	/* unsigned int */
+	MCP_DELTA,	/* unsigned int */
+	MCP_MEMBERS,	/* unsigned int */
+	MCP_MUTE,	/* gboolean */
+	MCP_SHOW_BIND,	/* gboolean */
+	MCP_SHOW_MUTE,	/* gboolean */
+	MCP_VALUE	/* unsigned int, the levels are accessed separately */
+} MixerControlProperty;
+# define MCP_LAST	MCP_VALUE
+# define MCP_COUNT	(MCP_LAST + 1)
+
+typedef struct _MixerControlDefinition2
+{
+	/* MIXERCONTROL_VERSION */
+	unsigned int version;
+
+	/* the properties are still given as a va_list when creating the
+	 * control, and for the properties not listed above */
+	MixerControlDefinition definition;
+
+	/* the remaining callbacks are optional, and return 0 or -1 */
+	int (*get_property)(MixerControlPlugin * plugin,
+			MixerControlProperty property, unsigned int * value);
+	int (*set_property)(MixerControlPlugin * plugin,
+			MixerControlProperty property, unsigned int value);
+
+	/* the levels of every channel, in percents */
+	int (*get_levels)(MixerControlPlugin * plugin, uint8_t * levels,
+			size_t levels_cnt);
+	int (*set_levels)(MixerControlPlugin * plugin, uint8_t const * levels,
+			size_t levels_cnt);
+} MixerControlDefinition2;
+
 #endif /* !DESKTOP_MIXER_CONTROL_H */
@@ -0,0 +1,95 @@
+/* $Id$ */
+/* Copyright (c) 2020 Pierre Pronchery <khorben@defora.org> */
+/* This file is part of DeforaOS Desktop Mixer */
+/* All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+
+#ifndef MIXER_BACKEND_H
+# define MIXER_BACKEND_H
+
+# include "device.h"
+
+
+/* MixerBackend */
+/* types */
+typedef struct _MixerBackend MixerBackend;
+
+typedef struct _MixerBackendDefinition
+{
+	String const * name;
+
+	/* returns NULL and sets errno upon errors */
+	MixerBackend * (*init)(String const * device);
+	void (*destroy)(MixerBackend * backend);
+
+	/* enumeration */
+	size_t (*get_count)(MixerBackend * backend);
+	MixerDeviceInfo const * (*get_info)(MixerBackend * backend,
+			size_t position);
+
+	/* the remaining calls return 0 or -errno */
+	int (*get_properties)(MixerBackend * backend,
+			MixerProperties * properties, char const ** error);
+	int (*get_value)(MixerBackend * backend, size_t position,
+			MixerValue * value, char const ** error);
+	int (*set_value)(MixerBackend * backend, size_t position,
+			MixerValue const * value, char const ** error);
+
+	/* change notification: 1 if the controls may have changed since the
+	 * last call, 0 otherwise */
+	int (*get_modified)(MixerBackend * backend);
+	/* optional: 1 if the control may have changed since it was last read,
+	 * 0 otherwise */
+	int (*get_changed)(MixerBackend * backend, size_t position);
+
+	/* calls issued to the driver */
+	unsigned long (*get_ioctls)(MixerBackend * backend);
+} MixerBackendDefinition;
+
+
+/* constants */
+/* conversion between the levels of the drivers (0-255) and percents, rounded
+ * so that every percent converts back to itself */
+# define MIXERBACKEND_LEVEL_PERCENT(level)	(((level) * 100 + 127) / 255)
+# define MIXERBACKEND_PERCENT_LEVEL(percent)	(((percent) * 255 + 50) / 100)
+
+
+/* variables */
+/* the conversions above, precomputed */
+extern uint8_t const mixerbackend_level_percent[256];
+extern uint8_t const mixerbackend_percent_level[101];
+
+# if defined(__NetBSD__)
+extern MixerBackendDefinition mixerbackend_netbsd;
+# else
+extern MixerBackendDefinition mixerbackend_oss;
+extern MixerBackendDefinition mixerbackend_oss4;
+# endif
+extern MixerBackendDefinition mixerbackend_sim;
+extern MixerBackendDefinition mixerbackend_trace;
+
+#endif /* !MIXER_BACKEND_H */
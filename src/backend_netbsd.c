@@ -0,0 +1,528 @@
+/* $Id$ */
+/* Copyright (c) 2020 Pierre Pronchery <khorben@defora.org> */
+/* This file is part of DeforaOS Desktop Mixer */
+/* All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+
+#if defined(__NetBSD__)
+# include <sys/ioctl.h>
+# include <sys/audioio.h>
+#endif
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include "backend.h"
+
+
+#ifdef AUDIO_MIXER_DEVINFO
+/* NetBSD */
+/* private */
+/* types */
+typedef struct _NetBSDEntry
+{
+	MixerDeviceInfo info;
+
+	/* index in the driver */
+	int index;
+	int valid;
+
+	/* last levels known to the driver */
+	u_char levels[MIXERDEVICE_CHANNELS_MAX];
+	size_t levels_cnt;
+} NetBSDEntry;
+
+struct _MixerBackend
+{
+	int fd;
+
+	NetBSDEntry * entries;
+	size_t entries_cnt;
+
+	unsigned long ioctls;
+};
+
+
+/* prototypes */
+static MixerBackend * _netbsd_init(String const * device);
+static void _netbsd_destroy(MixerBackend * netbsd);
+
+static size_t _netbsd_get_count(MixerBackend * netbsd);
+static MixerDeviceInfo const * _netbsd_get_info(MixerBackend * netbsd,
+		size_t position);
+static unsigned long _netbsd_get_ioctls(MixerBackend * netbsd);
+static int _netbsd_get_modified(MixerBackend * netbsd);
+static int _netbsd_get_properties(MixerBackend * netbsd,
+		MixerProperties * properties, char const ** error);
+static int _netbsd_get_value(MixerBackend * netbsd, size_t position,
+		MixerValue * value, char const ** error);
+
+static int _netbsd_set_value(MixerBackend * netbsd, size_t position,
+		MixerValue const * value, char const ** error);
+
+static int _netbsd_get_class(MixerBackend * netbsd, int index);
+static NetBSDEntry * _netbsd_get_entry(MixerBackend * netbsd,
+		size_t position);
+
+static int _netbsd_devinfo(MixerDeviceInfo * info, mixer_devinfo_t const * md);
+static int _netbsd_ioctl(MixerBackend * netbsd, unsigned long request,
+		void * data);
+
+
+/* public */
+/* variables */
+MixerBackendDefinition mixerbackend_netbsd =
+{
+	"netbsd",
+	_netbsd_init,
+	_netbsd_destroy,
+	_netbsd_get_count,
+	_netbsd_get_info,
+	_netbsd_get_properties,
+	_netbsd_get_value,
+	_netbsd_set_value,
+	_netbsd_get_modified,
+	NULL,
+	_netbsd_get_ioctls
+};
+
+
+/* private */
+/* functions */
+/* netbsd_init */
+static int _init_entries(MixerBackend * netbsd);
+static NetBSDEntry * _init_entry(MixerBackend * netbsd);
+
+static MixerBackend * _netbsd_init(String const * device)
+{
+	MixerBackend * netbsd;
+	int error;
+
+	if((netbsd = malloc(sizeof(*netbsd))) == NULL)
+		return NULL;
+	netbsd->fd = open(device, O_RDWR);
+	netbsd->entries = NULL;
+	netbsd->entries_cnt = 0;
+	netbsd->ioctls = 0;
+	if(netbsd->fd < 0 || _init_entries(netbsd) != 0)
+	{
+		error = errno;
+		_netbsd_destroy(netbsd);
+		errno = error;
+		return NULL;
+	}
+	return netbsd;
+}
+
+static int _init_entries(MixerBackend * netbsd)
+{
+	mixer_devinfo_t md;
+	NetBSDEntry * p;
+	MixerDeviceInfo * info;
+	size_t i;
+
+	for(md.index = 0; _netbsd_ioctl(netbsd, AUDIO_MIXER_DEVINFO, &md) == 0;
+			md.index++)
+	{
+		if((p = _init_entry(netbsd)) == NULL)
+			return -1;
+		p->index = md.index;
+		p->valid = 1;
+		/* ignore the unknown types */
+		if(_netbsd_devinfo(&p->info, &md) != 0)
+			netbsd->entries_cnt--;
+	}
+	/* the classes are referred to by position */
+	for(i = 0; i < netbsd->entries_cnt; i++)
+	{
+		info = &netbsd->entries[i].info;
+		info->mixer_class = _netbsd_get_class(netbsd,
+				info->mixer_class);
+	}
+	return 0;
+}
+
+static NetBSDEntry * _init_entry(MixerBackend * netbsd)
+{
+	NetBSDEntry * p;
+
+	if((p = realloc(netbsd->entries, sizeof(*p)
+					* (netbsd->entries_cnt + 1))) == NULL)
+		return NULL;
+	netbsd->entries = p;
+	p = &netbsd->entries[netbsd->entries_cnt++];
+	memset(p, 0, sizeof(*p));
+	return p;
+}
+
+
+/* netbsd_destroy */
+static void _netbsd_destroy(MixerBackend * netbsd)
+{
+	free(netbsd->entries);
+	if(netbsd->fd >= 0)
+		close(netbsd->fd);
+	free(netbsd);
+}
+
+
+/* accessors */
+/* netbsd_get_count */
+static size_t _netbsd_get_count(MixerBackend * netbsd)
+{
+	return netbsd->entries_cnt;
+}
+
+
+/* netbsd_get_info */
+static MixerDeviceInfo const * _netbsd_get_info(MixerBackend * netbsd,
+		size_t position)
+{
+	if(position >= netbsd->entries_cnt)
+		return NULL;
+	return &netbsd->entries[position].info;
+}
+
+
+/* netbsd_get_ioctls */
+static unsigned long _netbsd_get_ioctls(MixerBackend * netbsd)
+{
+	return netbsd->ioctls;
+}
+
+
+/* netbsd_get_modified */
+static int _netbsd_get_modified(MixerBackend * netbsd)
+{
+	/* no such counter: the controls have to be probed instead */
+	(void) netbsd;
+
+	return 1;
+}
+
+
+/* netbsd_get_properties */
+static int _netbsd_get_properties(MixerBackend * netbsd,
+		MixerProperties * properties, char const ** error)
+{
+	audio_device_t ad;
+
+	if(_netbsd_ioctl(netbsd, AUDIO_GETDEV, &ad) != 0)
+	{
+		*error = "AUDIO_GETDEV";
+		return -errno;
+	}
+	snprintf(properties->name, sizeof(properties->name), "%s", ad.name);
+	snprintf(properties->version, sizeof(properties->version), "%s",
+			ad.version);
+	snprintf(properties->device, sizeof(properties->device), "%s",
+			ad.config);
+	return 0;
+}
+
+
+/* netbsd_get_value */
+static int _netbsd_get_value(MixerBackend * netbsd, size_t position,
+		MixerValue * value, char const ** error)
+{
+	NetBSDEntry * entry;
+	MixerDeviceInfo * info;
+	mixer_ctrl_t p;
+	size_t i;
+# ifdef DEBUG
+	char * sep = "";
+# endif
+
+	if((entry = _netbsd_get_entry(netbsd, position)) == NULL)
+	{
+		*error = "AUDIO_MIXER_DEVINFO";
+		return -errno;
+	}
+	info = &entry->info;
+	p.dev = entry->index;
+	switch(info->type)
+	{
+		case MDT_ENUM:
+			p.type = AUDIO_MIXER_ENUM;
+			break;
+		case MDT_SET:
+			p.type = AUDIO_MIXER_SET;
+			break;
+		case MDT_VALUE:
+			p.type = AUDIO_MIXER_VALUE;
+			/* XXX this is necessary for some drivers */
+			p.un.value.num_channels = info->channels_cnt;
+			break;
+		default:
+			*error = "AUDIO_MIXER_READ";
+			return -EINVAL;
+	}
+	if(_netbsd_ioctl(netbsd, AUDIO_MIXER_READ, &p) != 0)
+	{
+		/* the control may be gone: look it up again next time */
+		if(errno == ENXIO)
+			entry->valid = 0;
+		*error = "AUDIO_MIXER_READ";
+		return -errno;
+	}
+# ifdef DEBUG
+	if(info->mixer_class >= 0)
+		printf("%s", netbsd->entries[info->mixer_class].info.name);
+	printf(".%s=", info->name);
+# endif
+	switch(info->type)
+	{
+		case MDT_ENUM:
+			value->ord = p.un.ord;
+# ifdef DEBUG
+			for(i = 0; i < info->members_cnt; i++)
+			{
+				if(info->members[i].value != p.un.ord)
+					continue;
+				printf("%s%s", sep, info->members[i].name);
+				break;
+			}
+# endif
+			break;
+		case MDT_SET:
+			value->mask = p.un.mask;
+# ifdef DEBUG
+			for(i = 0; i < info->members_cnt; i++)
+			{
+				if((p.un.mask & (1 << i)) == 0)
+					continue;
+				printf("%s%s", sep, info->members[i].name);
+				sep = ",";
+			}
+			printf("%s", "  {");
+			for(i = 0; i < info->members_cnt; i++)
+				printf(" %s", info->members[i].name);
+			printf("%s", " }");
+# endif
+			break;
+		default:
+			value->level.delta = info->delta;
+			value->level.channels_cnt = p.un.value.num_channels;
+			for(i = 0; i < value->level.channels_cnt; i++)
+			{
+# ifdef DEBUG
+				printf("%s%u", sep, p.un.value.level[i]);
+				sep = ",";
+# endif
+				value->level.channels[i]
+					= mixerbackend_level_percent[
+					p.un.value.level[i]];
+				entry->levels[i] = p.un.value.level[i];
+			}
+			entry->levels_cnt = value->level.channels_cnt;
+# ifdef DEBUG
+			printf(" delta=%u", info->delta);
+# endif
+			break;
+	}
+# ifdef DEBUG
+	putchar('\n');
+# endif
+	return 0;
+}
+
+
+/* netbsd_set_value */
+static int _netbsd_set_value(MixerBackend * netbsd, size_t position,
+		MixerValue const * value, char const ** error)
+{
+	NetBSDEntry * entry;
+	mixer_ctrl_t p;
+	size_t i;
+	uint8_t percent;
+
+	if((entry = _netbsd_get_entry(netbsd, position)) == NULL)
+	{
+		*error = "AUDIO_MIXER_DEVINFO";
+		return -errno;
+	}
+	p.dev = entry->index;
+	switch(entry->info.type)
+	{
+		case MDT_ENUM:
+			p.type = AUDIO_MIXER_ENUM;
+			p.un.ord = value->ord;
+			break;
+		case MDT_SET:
+			p.type = AUDIO_MIXER_SET;
+			p.un.mask = value->mask;
+			break;
+		case MDT_VALUE:
+			p.type = AUDIO_MIXER_VALUE;
+			p.un.value.num_channels = value->level.channels_cnt;
+			for(i = 0; i < value->level.channels_cnt; i++)
+			{
+				percent = (value->level.channels[i] <= 100)
+					? value->level.channels[i] : 100;
+				/* keep the level of the driver when possible:
+				 * not every level has its own percentage */
+				if(i < entry->levels_cnt
+						&& mixerbackend_level_percent[
+						entry->levels[i]] == percent)
+					p.un.value.level[i] = entry->levels[i];
+				else
+					p.un.value.level[i]
+						= mixerbackend_percent_level[
+						percent];
+			}
+			break;
+		default:
+			*error = "AUDIO_MIXER_WRITE";
+			return -EINVAL;
+	}
+	if(_netbsd_ioctl(netbsd, AUDIO_MIXER_WRITE, &p) != 0)
+	{
+		*error = "AUDIO_MIXER_WRITE";
+		return -errno;
+	}
+	if(entry->info.type == MDT_VALUE)
+	{
+		for(i = 0; i < value->level.channels_cnt; i++)
+			entry->levels[i] = p.un.value.level[i];
+		entry->levels_cnt = value->level.channels_cnt;
+	}
+	return 0;
+}
+
+
+/* netbsd_get_class */
+static int _netbsd_get_class(MixerBackend * netbsd, int index)
+{
+	size_t i;
+
+	for(i = 0; i < netbsd->entries_cnt; i++)
+		if(netbsd->entries[i].info.type == MDT_CLASS
+				&& netbsd->entries[i].index == index)
+			return (int)i;
+	return -1;
+}
+
+
+/* netbsd_get_entry */
+static NetBSDEntry * _netbsd_get_entry(MixerBackend * netbsd,
+		size_t position)
+{
+	NetBSDEntry * entry;
+	mixer_devinfo_t md;
+	MixerDeviceInfo info;
+
+	if(position >= netbsd->entries_cnt)
+	{
+		errno = ENXIO;
+		return NULL;
+	}
+	entry = &netbsd->entries[position];
+	if(entry->valid)
+		return entry;
+	/* the entry was invalidated: its description may have changed */
+	md.index = entry->index;
+	if(_netbsd_ioctl(netbsd, AUDIO_MIXER_DEVINFO, &md) != 0)
+		return NULL;
+	if(_netbsd_devinfo(&info, &md) != 0)
+	{
+		errno = ENXIO;
+		return NULL;
+	}
+	info.mixer_class = _netbsd_get_class(netbsd, md.mixer_class);
+	entry->info = info;
+	entry->levels_cnt = 0;
+	entry->valid = 1;
+	return entry;
+}
+
+
+/* useful */
+/* netbsd_devinfo */
+static int _netbsd_devinfo(MixerDeviceInfo * info, mixer_devinfo_t const * md)
+{
+	int k;
+
+	/* resolved by the caller */
+	info->mixer_class = md->mixer_class;
+	snprintf(info->name, sizeof(info->name), "%s", md->label.name);
+	switch(md->type)
+	{
+		case AUDIO_MIXER_CLASS:
+			info->type = MDT_CLASS;
+			break;
+		case AUDIO_MIXER_ENUM:
+			info->type = MDT_ENUM;
+			for(k = 0; k < md->un.e.num_mem && (size_t)k
+					< sizeof(info->members)
+					/ sizeof(*info->members); k++)
+			{
+				snprintf(info->members[k].name,
+					sizeof(info->members[k].name),
+					"%s", md->un.e.member[k].label.name);
+				info->members[k].value
+					= md->un.e.member[k].ord;
+			}
+			info->members_cnt = k;
+			break;
+		case AUDIO_MIXER_SET:
+			info->type = MDT_SET;
+			for(k = 0; k < md->un.s.num_mem && (size_t)k
+					< sizeof(info->members)
+					/ sizeof(*info->members); k++)
+			{
+				snprintf(info->members[k].name,
+					sizeof(info->members[k].name),
+					"%s", md->un.s.member[k].label.name);
+				info->members[k].value
+					= md->un.s.member[k].mask;
+			}
+			info->members_cnt = k;
+			break;
+		case AUDIO_MIXER_VALUE:
+			info->type = MDT_VALUE;
+			info->channels_cnt = md->un.v.num_channels;
+			if((info->delta = (md->un.v.delta * 100 + 254)
+						/ 255) == 0)
+				info->delta = 1;
+			break;
+		default:
+			return -1;
+	}
+	return 0;
+}
+
+
+/* netbsd_ioctl */
+static int _netbsd_ioctl(MixerBackend * netbsd, unsigned long request,
+		void * data)
+{
+	netbsd->ioctls++;
+	return ioctl(netbsd->fd, request, data);
+}
+#endif /* AUDIO_MIXER_DEVINFO */
@@ -0,0 +1,443 @@
+/* $Id$ */
+/* Copyright (c) 2020 Pierre Pronchery <khorben@defora.org> */
+/* This file is part of DeforaOS Desktop Mixer */
+/* All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+
+#if !defined(__NetBSD__)
+# include <sys/ioctl.h>
+# include <sys/soundcard.h>
+#endif
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include "backend.h"
+
+
+#if !defined(__NetBSD__)
+/* OSS */
+/* private */
+/* constants */
+/* the counter may not account for every change, as with the emulation in
+ * ALSA which ignores the other clients: probe every second anyway */
+#define OSS_PROBE_INTERVAL	1
+
+
+/* types */
+typedef struct _OSSEntry
+{
+	MixerDeviceInfo info;
+
+	/* index in the driver, or -1 for the recording source */
+	int index;
+} OSSEntry;
+
+struct _MixerBackend
+{
+	String * name;
+	int fd;
+
+	OSSEntry * entries;
+	size_t entries_cnt;
+
+	int modify_counter;
+	time_t probed;
+	unsigned long ioctls;
+};
+
+
+/* prototypes */
+static MixerBackend * _oss_init(String const * device);
+static void _oss_destroy(MixerBackend * oss);
+
+static size_t _oss_get_count(MixerBackend * oss);
+static MixerDeviceInfo const * _oss_get_info(MixerBackend * oss,
+		size_t position);
+static unsigned long _oss_get_ioctls(MixerBackend * oss);
+static int _oss_get_modified(MixerBackend * oss);
+static int _oss_get_properties(MixerBackend * oss,
+		MixerProperties * properties, char const ** error);
+static int _oss_get_value(MixerBackend * oss, size_t position,
+		MixerValue * value, char const ** error);
+
+static int _oss_set_value(MixerBackend * oss, size_t position,
+		MixerValue const * value, char const ** error);
+
+static OSSEntry * _oss_get_entry(MixerBackend * oss, size_t position);
+static int _oss_get_modify_counter(MixerBackend * oss);
+static time_t _oss_get_time(void);
+
+static int _oss_ioctl(MixerBackend * oss, unsigned long request, void * data);
+
+
+/* public */
+/* variables */
+MixerBackendDefinition mixerbackend_oss =
+{
+	"oss",
+	_oss_init,
+	_oss_destroy,
+	_oss_get_count,
+	_oss_get_info,
+	_oss_get_properties,
+	_oss_get_value,
+	_oss_set_value,
+	_oss_get_modified,
+	NULL,
+	_oss_get_ioctls
+};
+
+
+/* private */
+/* functions */
+/* oss_init */
+static int _init_entries(MixerBackend * oss);
+static int _init_entries_recsrc(MixerBackend * oss, int recmask);
+static OSSEntry * _init_entry(MixerBackend * oss);
+
+static MixerBackend * _oss_init(String const * device)
+{
+	MixerBackend * oss;
+	int error;
+
+	if((oss = malloc(sizeof(*oss))) == NULL)
+		return NULL;
+	oss->name = string_new(device);
+	oss->fd = open(device, O_RDWR);
+	oss->entries = NULL;
+	oss->entries_cnt = 0;
+	oss->modify_counter = -1;
+	oss->probed = _oss_get_time();
+	oss->ioctls = 0;
+	if(oss->name == NULL || oss->fd < 0 || _init_entries(oss) != 0)
+	{
+		error = errno;
+		_oss_destroy(oss);
+		errno = error;
+		return NULL;
+	}
+	oss->modify_counter = _oss_get_modify_counter(oss);
+	return oss;
+}
+
+static int _init_entries(MixerBackend * oss)
+{
+	char const * labels[] = SOUND_DEVICE_LABELS;
+	char const * names[] = SOUND_DEVICE_NAMES;
+	OSSEntry * p;
+	int i;
+	int value;
+	int devmask;
+	int stereodevs;
+	int recmask;
+
+	/* the devices present are only probed if the driver cannot tell */
+	if(_oss_ioctl(oss, SOUND_MIXER_READ_DEVMASK, &devmask) != 0)
+		devmask = -1;
+	if(_oss_ioctl(oss, SOUND_MIXER_READ_STEREODEVS, &stereodevs) != 0)
+		stereodevs = -1;
+	if(_oss_ioctl(oss, SOUND_MIXER_READ_RECMASK, &recmask) != 0)
+		recmask = 0;
+	for(i = 0; i < SOUND_MIXER_NRDEVICES; i++)
+	{
+		if((devmask & (1 << i)) == 0)
+			continue;
+		if(devmask == -1 && _oss_ioctl(oss, MIXER_READ(i), &value)
+				!= 0)
+			continue;
+		if((p = _init_entry(oss)) == NULL)
+			return -1;
+		p->index = i;
+		p->info.type = MDT_VALUE;
+		p->info.mixer_class = -1;
+		snprintf(p->info.name, sizeof(p->info.name), "%s", names[i]);
+		snprintf(p->info.label, sizeof(p->info.label), "%s", labels[i]);
+		p->info.channels_cnt = (stereodevs & (1 << i)) ? 2 : 1;
+		p->info.delta = 1;
+	}
+	return _init_entries_recsrc(oss, recmask);
+}
+
+static int _init_entries_recsrc(MixerBackend * oss, int recmask)
+{
+	char const * names[] = SOUND_DEVICE_NAMES;
+	OSSEntry * p;
+	int caps;
+	int i;
+
+	if(recmask == 0)
+		return 0;
+	if(_oss_ioctl(oss, SOUND_MIXER_READ_CAPS, &caps) != 0)
+		caps = 0;
+	if((p = _init_entry(oss)) == NULL)
+		return -1;
+	p->index = -1;
+	/* some drivers record from a single source at a time */
+	p->info.type = (caps & SOUND_CAP_EXCL_INPUT) ? MDT_ENUM : MDT_SET;
+	p->info.mixer_class = -1;
+	snprintf(p->info.name, sizeof(p->info.name), "%s", "recsrc");
+	snprintf(p->info.label, sizeof(p->info.label), "%s", "Record");
+	for(i = 0; i < SOUND_MIXER_NRDEVICES; i++)
+		if(recmask & (1 << i))
+		{
+			snprintf(p->info.members[p->info.members_cnt].name,
+					sizeof(p->info.members[
+						p->info.members_cnt].name),
+					"%s", names[i]);
+			p->info.members[p->info.members_cnt++].value = 1 << i;
+		}
+	return 0;
+}
+
+static OSSEntry * _init_entry(MixerBackend * oss)
+{
+	OSSEntry * p;
+
+	if((p = realloc(oss->entries, sizeof(*p) * (oss->entries_cnt + 1)))
+			== NULL)
+		return NULL;
+	oss->entries = p;
+	p = &oss->entries[oss->entries_cnt++];
+	memset(p, 0, sizeof(*p));
+	return p;
+}
+
+
+/* oss_destroy */
+static void _oss_destroy(MixerBackend * oss)
+{
+	free(oss->entries);
+	if(oss->fd >= 0)
+		close(oss->fd);
+	if(oss->name != NULL)
+		string_delete(oss->name);
+	free(oss);
+}
+
+
+/* accessors */
+/* oss_get_count */
+static size_t _oss_get_count(MixerBackend * oss)
+{
+	return oss->entries_cnt;
+}
+
+
+/* oss_get_info */
+static MixerDeviceInfo const * _oss_get_info(MixerBackend * oss,
+		size_t position)
+{
+	if(position >= oss->entries_cnt)
+		return NULL;
+	return &oss->entries[position].info;
+}
+
+
+/* oss_get_ioctls */
+static unsigned long _oss_get_ioctls(MixerBackend * oss)
+{
+	return oss->ioctls;
+}
+
+
+/* oss_get_modified */
+static int _oss_get_modified(MixerBackend * oss)
+{
+	int counter;
+	time_t now;
+
+	/* the controls have to be probed if there is no counter */
+	if(oss->modify_counter < 0)
+		return 1;
+	now = _oss_get_time();
+	if((counter = _oss_get_modify_counter(oss)) == oss->modify_counter
+			&& now - oss->probed < OSS_PROBE_INTERVAL)
+		return 0;
+	oss->modify_counter = counter;
+	oss->probed = now;
+	return 1;
+}
+
+
+/* oss_get_properties */
+static int _oss_get_properties(MixerBackend * oss,
+		MixerProperties * properties, char const ** error)
+{
+	struct mixer_info mi;
+	int version;
+
+	if(_oss_ioctl(oss, SOUND_MIXER_INFO, &mi) != 0)
+	{
+		*error = "SOUND_MIXER_INFO";
+		return -errno;
+	}
+	if(_oss_ioctl(oss, OSS_GETVERSION, &version) != 0)
+	{
+		*error = "OSS_GETVERSION";
+		return -errno;
+	}
+	snprintf(properties->name, sizeof(properties->name), "%s", mi.name);
+	snprintf(properties->version, sizeof(properties->version), "%u.%u",
+			(version >> 16) & 0xffff, version & 0xffff);
+	snprintf(properties->device, sizeof(properties->device), "%s",
+			oss->name);
+	return 0;
+}
+
+
+/* oss_get_value */
+static int _oss_get_value(MixerBackend * oss, size_t position,
+		MixerValue * value, char const ** error)
+{
+	OSSEntry * entry;
+	int level;
+
+	if((entry = _oss_get_entry(oss, position)) == NULL)
+	{
+		*error = "MIXER_READ";
+		return -errno;
+	}
+	if(entry->index < 0)
+	{
+		if(_oss_ioctl(oss, SOUND_MIXER_READ_RECSRC, &level) != 0)
+		{
+			*error = "SOUND_MIXER_READ_RECSRC";
+			return -errno;
+		}
+		value->mask = level;
+		return 0;
+	}
+	if(_oss_ioctl(oss, MIXER_READ(entry->index), &level) != 0)
+	{
+		*error = "MIXER_READ";
+		return -errno;
+	}
+	value->level.delta = entry->info.delta;
+	value->level.channels_cnt = entry->info.channels_cnt;
+	value->level.channels[0] = level & 0xff;
+	value->level.channels[1] = (level & 0xff00) >> 8;
+#ifdef DEBUG
+	fprintf(stderr, "DEBUG: %s() % 3d % 3d\n", __func__,
+			value->level.channels[0], value->level.channels[1]);
+#endif
+	return 0;
+}
+
+
+/* oss_set_value */
+static int _oss_set_value(MixerBackend * oss, size_t position,
+		MixerValue const * value, char const ** error)
+{
+	OSSEntry * entry;
+	int level;
+
+	if((entry = _oss_get_entry(oss, position)) == NULL)
+	{
+		*error = "MIXER_WRITE";
+		return -errno;
+	}
+	if(entry->index < 0)
+	{
+		level = value->mask;
+		if(_oss_ioctl(oss, SOUND_MIXER_WRITE_RECSRC, &level) != 0)
+		{
+			*error = "SOUND_MIXER_WRITE_RECSRC";
+			return -errno;
+		}
+	}
+	else
+	{
+		/* the mono devices are given the same level on both sides */
+		level = (((entry->info.channels_cnt > 1)
+					? value->level.channels[1]
+					: value->level.channels[0]) << 8)
+			| value->level.channels[0];
+#ifdef DEBUG
+		fprintf(stderr, "DEBUG: %s() level=0x%04x\n", __func__,
+				level);
+#endif
+		if(_oss_ioctl(oss, MIXER_WRITE(entry->index), &level) != 0)
+		{
+			*error = "MIXER_WRITE";
+			return -errno;
+		}
+	}
+	/* fall back to probing if the driver does not maintain the counter */
+	if(oss->modify_counter >= 0 && _oss_get_modify_counter(oss)
+			== oss->modify_counter)
+		oss->modify_counter = -1;
+	return 0;
+}
+
+
+/* oss_get_entry */
+static OSSEntry * _oss_get_entry(MixerBackend * oss, size_t position)
+{
+	if(position >= oss->entries_cnt)
+	{
+		errno = ENXIO;
+		return NULL;
+	}
+	return &oss->entries[position];
+}
+
+
+/* oss_get_modify_counter */
+static int _oss_get_modify_counter(MixerBackend * oss)
+{
+	struct mixer_info mi;
+
+	if(_oss_ioctl(oss, SOUND_MIXER_INFO, &mi) != 0
+			|| mi.modify_counter < 0)
+		return -1;
+	return mi.modify_counter;
+}
+
+
+/* oss_get_time */
+static time_t _oss_get_time(void)
+{
+	struct timespec ts;
+
+	if(clock_gettime(CLOCK_MONOTONIC, &ts) != 0)
+		return 0;
+	return ts.tv_sec;
+}
+
+
+/* useful */
+/* oss_ioctl */
+static int _oss_ioctl(MixerBackend * oss, unsigned long request, void * data)
+{
+	oss->ioctls++;
+	return ioctl(oss->fd, request, data);
+}
+#endif /* !__NetBSD__ */
@@ -0,0 +1,618 @@
+/* $Id$ */
+/* Copyright (c) 2020 Pierre Pronchery <khorben@defora.org> */
+/* This file is part of DeforaOS Desktop Mixer */
+/* All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+
+#if !defined(__NetBSD__)
+# include <sys/ioctl.h>
+# include <sys/soundcard.h>
+#endif
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include "backend.h"
+
+
+#if !defined(__NetBSD__)
+/* OSS4 */
+/* private */
+# ifdef SNDCTL_MIX_EXTINFO
+/* types */
+typedef struct _OSS4Entry
+{
+	MixerDeviceInfo info;
+
+	/* extension in the driver */
+	int ctrl;
+	int type;
+	int minvalue;
+	int maxvalue;
+	int timestamp;
+
+	/* update counter as last read, and as last seen */
+	int update_counter;
+	int update_seen;
+} OSS4Entry;
+
+struct _MixerBackend
+{
+	String * name;
+	int fd;
+	int dev;
+
+	OSS4Entry * entries;
+	size_t entries_cnt;
+
+	int modify_counter;
+	unsigned long ioctls;
+};
+
+
+/* prototypes */
+static MixerBackend * _oss4_init(String const * device);
+static void _oss4_destroy(MixerBackend * oss4);
+
+static int _oss4_get_changed(MixerBackend * oss4, size_t position);
+static size_t _oss4_get_count(MixerBackend * oss4);
+static MixerDeviceInfo const * _oss4_get_info(MixerBackend * oss4,
+		size_t position);
+static unsigned long _oss4_get_ioctls(MixerBackend * oss4);
+static int _oss4_get_modified(MixerBackend * oss4);
+static int _oss4_get_properties(MixerBackend * oss4,
+		MixerProperties * properties, char const ** error);
+static int _oss4_get_value(MixerBackend * oss4, size_t position,
+		MixerValue * value, char const ** error);
+
+static int _oss4_set_value(MixerBackend * oss4, size_t position,
+		MixerValue const * value, char const ** error);
+
+static OSS4Entry * _oss4_get_entry(MixerBackend * oss4, size_t position);
+static int _oss4_get_modify_counter(MixerBackend * oss4);
+
+static int _oss4_ioctl(MixerBackend * oss4, unsigned long request,
+		void * data);
+
+
+/* public */
+/* variables */
+MixerBackendDefinition mixerbackend_oss4 =
+{
+	"oss4",
+	_oss4_init,
+	_oss4_destroy,
+	_oss4_get_count,
+	_oss4_get_info,
+	_oss4_get_properties,
+	_oss4_get_value,
+	_oss4_set_value,
+	_oss4_get_modified,
+	_oss4_get_changed,
+	_oss4_get_ioctls
+};
+
+
+/* private */
+/* functions */
+/* oss4_init */
+static int _init_entries(MixerBackend * oss4);
+static int _init_entries_enum(MixerBackend * oss4, OSS4Entry * entry,
+		oss_mixext const * ext);
+static OSS4Entry * _init_entry(MixerBackend * oss4);
+
+static MixerBackend * _oss4_init(String const * device)
+{
+	MixerBackend * oss4;
+	oss_mixerinfo mi;
+	int error;
+
+	if((oss4 = malloc(sizeof(*oss4))) == NULL)
+		return NULL;
+	oss4->name = string_new(device);
+	oss4->fd = open(device, O_RDWR);
+	oss4->dev = -1;
+	oss4->entries = NULL;
+	oss4->entries_cnt = 0;
+	oss4->modify_counter = -1;
+	oss4->ioctls = 0;
+	/* the mixer device of the node opened */
+	mi.dev = -1;
+	if(oss4->name == NULL || oss4->fd < 0
+			|| _oss4_ioctl(oss4, SNDCTL_MIXERINFO, &mi) != 0
+			|| (oss4->dev = mi.dev) < 0
+			|| _init_entries(oss4) != 0)
+	{
+		error = errno;
+		_oss4_destroy(oss4);
+		errno = error;
+		return NULL;
+	}
+	oss4->modify_counter = mi.modify_counter;
+	return oss4;
+}
+
+static int _init_entries(MixerBackend * oss4)
+{
+	int ret = 0;
+	int cnt;
+	int * tops;
+	int top;
+	oss_mixext ext;
+	OSS4Entry * p;
+	MixerDeviceInfo * info;
+	int64_t range;
+	size_t i;
+	size_t j;
+	int k;
+
+	cnt = oss4->dev;
+	if(_oss4_ioctl(oss4, SNDCTL_MIX_NREXT, &cnt) != 0)
+		return -1;
+	/* the nested groups are merged into their top-level group */
+	if((tops = malloc(sizeof(*tops) * (cnt + 1))) == NULL)
+		return -1;
+	for(k = 0; k < cnt; k++)
+	{
+		memset(&ext, 0, sizeof(ext));
+		ext.dev = oss4->dev;
+		ext.ctrl = k;
+		if(_oss4_ioctl(oss4, SNDCTL_MIX_EXTINFO, &ext) != 0)
+		{
+			ret = -1;
+			break;
+		}
+		top = (ext.parent >= 0 && ext.parent < k) ? tops[ext.parent]
+			: -1;
+		tops[k] = (ext.type == MIXT_GROUP && top < 0) ? k : top;
+		switch(ext.type)
+		{
+			case MIXT_GROUP:
+				/* only the top-level groups are classes */
+				if(top >= 0)
+					continue;
+				break;
+			case MIXT_ONOFF:
+			case MIXT_MUTE:
+			case MIXT_ENUM:
+			case MIXT_MONOSLIDER:
+			case MIXT_STEREOSLIDER:
+			case MIXT_MONOSLIDER16:
+			case MIXT_STEREOSLIDER16:
+			case MIXT_SLIDER:
+				if(ext.flags & MIXF_READABLE)
+					break;
+				continue;
+			default:
+				/* ignore the root, meters and unknown types */
+				continue;
+		}
+		if((p = _init_entry(oss4)) == NULL)
+		{
+			ret = -1;
+			break;
+		}
+		p->ctrl = k;
+		p->type = ext.type;
+		p->minvalue = ext.minvalue;
+		p->maxvalue = (ext.maxvalue > ext.minvalue) ? ext.maxvalue
+			: ext.minvalue + 1;
+		p->timestamp = ext.timestamp;
+		/* the controls have not been read yet */
+		p->update_counter = ext.update_counter;
+		p->update_seen = ext.update_counter - 1;
+		info = &p->info;
+		/* resolved below */
+		info->mixer_class = (ext.type == MIXT_GROUP) ? -1 : top;
+		snprintf(info->name, sizeof(info->name), "%s",
+				(ext.extname[0] != '\0') ? ext.extname : ext.id);
+		snprintf(info->label, sizeof(info->label), "%s", ext.id);
+		switch(ext.type)
+		{
+			case MIXT_GROUP:
+				info->type = MDT_CLASS;
+				break;
+			case MIXT_ONOFF:
+			case MIXT_MUTE:
+				info->type = MDT_ENUM;
+				snprintf(info->members[0].name,
+						sizeof(info->members[0].name),
+						"%s", "off");
+				info->members[0].value = 0;
+				snprintf(info->members[1].name,
+						sizeof(info->members[1].name),
+						"%s", "on");
+				info->members[1].value = 1;
+				info->members_cnt = 2;
+				break;
+			case MIXT_ENUM:
+				info->type = MDT_ENUM;
+				if(_init_entries_enum(oss4, p, &ext) != 0)
+					oss4->entries_cnt--;
+				break;
+			default:
+				info->type = MDT_VALUE;
+				info->channels_cnt = (ext.type == MIXT_STEREOSLIDER
+						|| ext.type
+						== MIXT_STEREOSLIDER16) ? 2 : 1;
+				range = (int64_t)p->maxvalue - p->minvalue;
+				if((info->delta = (100 + range - 1) / range) == 0)
+					info->delta = 1;
+				break;
+		}
+	}
+	free(tops);
+	if(ret != 0)
+		return ret;
+	/* the classes are referred to by position */
+	for(i = 0; i < oss4->entries_cnt; i++)
+	{
+		info = &oss4->entries[i].info;
+		if(info->mixer_class < 0)
+			continue;
+		for(j = 0; j < oss4->entries_cnt; j++)
+			if(oss4->entries[j].info.type == MDT_CLASS
+					&& oss4->entries[j].ctrl
+					== info->mixer_class)
+				break;
+		info->mixer_class = (j < oss4->entries_cnt) ? (int)j : -1;
+	}
+	return 0;
+}
+
+static int _init_entries_enum(MixerBackend * oss4, OSS4Entry * entry,
+		oss_mixext const * ext)
+{
+	oss_mixer_enuminfo ei;
+	MixerDeviceInfo * info = &entry->info;
+	int i;
+
+	memset(&ei, 0, sizeof(ei));
+	ei.dev = oss4->dev;
+	ei.ctrl = entry->ctrl;
+	if(_oss4_ioctl(oss4, SNDCTL_MIX_ENUMINFO, &ei) != 0)
+		return -1;
+	for(i = 0; i < ei.nvalues && i < ext->maxvalue
+			&& info->members_cnt < sizeof(info->members)
+			/ sizeof(*info->members); i++)
+	{
+		/* skip the values not available */
+		if((ext->enum_present[i / 8] & (1 << (i % 8))) == 0
+				|| ei.strindex[i] < 0 || (size_t)ei.strindex[i]
+				>= sizeof(ei.strings))
+			continue;
+		snprintf(info->members[info->members_cnt].name,
+				sizeof(info->members[info->members_cnt].name),
+				"%s", &ei.strings[ei.strindex[i]]);
+		info->members[info->members_cnt++].value = i;
+	}
+	return 0;
+}
+
+static OSS4Entry * _init_entry(MixerBackend * oss4)
+{
+	OSS4Entry * p;
+
+	if((p = realloc(oss4->entries, sizeof(*p) * (oss4->entries_cnt + 1)))
+			== NULL)
+		return NULL;
+	oss4->entries = p;
+	p = &oss4->entries[oss4->entries_cnt++];
+	memset(p, 0, sizeof(*p));
+	return p;
+}
+
+
+/* oss4_destroy */
+static void _oss4_destroy(MixerBackend * oss4)
+{
+	free(oss4->entries);
+	if(oss4->fd >= 0)
+		close(oss4->fd);
+	if(oss4->name != NULL)
+		string_delete(oss4->name);
+	free(oss4);
+}
+
+
+/* accessors */
+/* oss4_get_changed */
+static int _oss4_get_changed(MixerBackend * oss4, size_t position)
+{
+	OSS4Entry * entry;
+	oss_mixext ext;
+
+	if((entry = _oss4_get_entry(oss4, position)) == NULL)
+		return -1;
+	/* the description is kept by the kernel, unlike the values which may
+	 * have to be obtained from the hardware */
+	memset(&ext, 0, sizeof(ext));
+	ext.dev = oss4->dev;
+	ext.ctrl = entry->ctrl;
+	if(_oss4_ioctl(oss4, SNDCTL_MIX_EXTINFO, &ext) != 0)
+		return -1;
+	entry->update_counter = ext.update_counter;
+	return (entry->update_counter != entry->update_seen) ? 1 : 0;
+}
+
+
+/* oss4_get_count */
+static size_t _oss4_get_count(MixerBackend * oss4)
+{
+	return oss4->entries_cnt;
+}
+
+
+/* oss4_get_info */
+static MixerDeviceInfo const * _oss4_get_info(MixerBackend * oss4,
+		size_t position)
+{
+	if(position >= oss4->entries_cnt)
+		return NULL;
+	return &oss4->entries[position].info;
+}
+
+
+/* oss4_get_ioctls */
+static unsigned long _oss4_get_ioctls(MixerBackend * oss4)
+{
+	return oss4->ioctls;
+}
+
+
+/* oss4_get_modified */
+static int _oss4_get_modified(MixerBackend * oss4)
+{
+	int counter;
+
+	if(oss4->modify_counter < 0)
+		return 1;
+	if((counter = _oss4_get_modify_counter(oss4)) == oss4->modify_counter)
+		return 0;
+	oss4->modify_counter = counter;
+	return 1;
+}
+
+
+/* oss4_get_properties */
+static int _oss4_get_properties(MixerBackend * oss4,
+		MixerProperties * properties, char const ** error)
+{
+	oss_mixerinfo mi;
+	oss_sysinfo si;
+
+	mi.dev = oss4->dev;
+	if(_oss4_ioctl(oss4, SNDCTL_MIXERINFO, &mi) != 0)
+	{
+		*error = "SNDCTL_MIXERINFO";
+		return -errno;
+	}
+	if(_oss4_ioctl(oss4, SNDCTL_SYSINFO, &si) != 0)
+	{
+		*error = "SNDCTL_SYSINFO";
+		return -errno;
+	}
+	snprintf(properties->name, sizeof(properties->name), "%s", mi.name);
+	snprintf(properties->version, sizeof(properties->version), "%s",
+			si.version);
+	snprintf(properties->device, sizeof(properties->device), "%s",
+			oss4->name);
+	return 0;
+}
+
+
+/* oss4_get_value */
+static int _oss4_get_value(MixerBackend * oss4, size_t position,
+		MixerValue * value, char const ** error)
+{
+	OSS4Entry * entry;
+	oss_mixer_value v;
+	int shift;
+	int mask;
+	int64_t level;
+	int64_t range;
+	size_t i;
+
+	if((entry = _oss4_get_entry(oss4, position)) == NULL)
+	{
+		*error = "SNDCTL_MIX_READ";
+		return -errno;
+	}
+	memset(&v, 0, sizeof(v));
+	v.dev = oss4->dev;
+	v.ctrl = entry->ctrl;
+	v.timestamp = entry->timestamp;
+	if(_oss4_ioctl(oss4, SNDCTL_MIX_READ, &v) != 0)
+	{
+		*error = "SNDCTL_MIX_READ";
+		return -errno;
+	}
+	entry->update_seen = entry->update_counter;
+	switch(entry->info.type)
+	{
+		case MDT_ENUM:
+			value->ord = v.value;
+			break;
+		default:
+			shift = (entry->type == MIXT_MONOSLIDER16
+					|| entry->type == MIXT_STEREOSLIDER16)
+				? 16 : 8;
+			mask = (entry->type == MIXT_SLIDER) ? -1
+				: (1 << shift) - 1;
+			value->level.delta = entry->info.delta;
+			value->level.channels_cnt = entry->info.channels_cnt;
+			range = (int64_t)entry->maxvalue - entry->minvalue;
+			/* rounded so that the levels written read back the same */
+			for(i = 0; i < value->level.channels_cnt; i++)
+			{
+				/* the plain sliders may go below zero */
+				if(entry->type == MIXT_SLIDER)
+					level = v.value;
+				else
+					level = ((unsigned int)v.value
+							>> (shift * i)) & mask;
+				if(entry->minvalue == 0 && entry->maxvalue == 255
+						&& level <= 255)
+					level = mixerbackend_level_percent[level];
+				else if((level -= entry->minvalue) <= 0)
+					level = 0;
+				else if((level = (level * 100 + range / 2)
+							/ range) > 100)
+					level = 100;
+				value->level.channels[i] = level;
+			}
+			break;
+	}
+	return 0;
+}
+
+
+/* oss4_set_value */
+static int _oss4_set_value(MixerBackend * oss4, size_t position,
+		MixerValue const * value, char const ** error)
+{
+	OSS4Entry * entry;
+	oss_mixer_value v;
+	int shift;
+	unsigned int u;
+	int64_t level;
+	size_t i;
+
+	if((entry = _oss4_get_entry(oss4, position)) == NULL)
+	{
+		*error = "SNDCTL_MIX_WRITE";
+		return -errno;
+	}
+	memset(&v, 0, sizeof(v));
+	v.dev = oss4->dev;
+	v.ctrl = entry->ctrl;
+	v.timestamp = entry->timestamp;
+	switch(entry->info.type)
+	{
+		case MDT_ENUM:
+			v.value = value->ord;
+			break;
+		default:
+			shift = (entry->type == MIXT_MONOSLIDER16
+					|| entry->type == MIXT_STEREOSLIDER16)
+				? 16 : 8;
+			for(i = 0; i < entry->info.channels_cnt
+					&& i < value->level.channels_cnt; i++)
+			{
+				if((u = value->level.channels[i]) > 100)
+					u = 100;
+				level = (entry->minvalue == 0
+						&& entry->maxvalue == 255)
+					? mixerbackend_percent_level[u]
+					: entry->minvalue + (u * ((int64_t)
+								entry->maxvalue
+								- entry->minvalue)
+							+ 50) / 100;
+				v.value |= (unsigned int)level << (shift * i);
+			}
+			break;
+	}
+	if(_oss4_ioctl(oss4, SNDCTL_MIX_WRITE, &v) != 0)
+	{
+		*error = "SNDCTL_MIX_WRITE";
+		return -errno;
+	}
+	return 0;
+}
+
+
+/* oss4_get_entry */
+static OSS4Entry * _oss4_get_entry(MixerBackend * oss4, size_t position)
+{
+	if(position >= oss4->entries_cnt)
+	{
+		errno = ENXIO;
+		return NULL;
+	}
+	return &oss4->entries[position];
+}
+
+
+/* oss4_get_modify_counter */
+static int _oss4_get_modify_counter(MixerBackend * oss4)
+{
+	oss_mixerinfo mi;
+
+	mi.dev = oss4->dev;
+	if(_oss4_ioctl(oss4, SNDCTL_MIXERINFO, &mi) != 0
+			|| mi.modify_counter < 0)
+		return -1;
+	return mi.modify_counter;
+}
+
+
+/* useful */
+/* oss4_ioctl */
+static int _oss4_ioctl(MixerBackend * oss4, unsigned long request,
+		void * data)
+{
+	oss4->ioctls++;
+	return ioctl(oss4->fd, request, data);
+}
+# else
+/* prototypes */
+static MixerBackend * _oss4_init(String const * device);
+
+
+/* public */
+/* variables */
+/* the extended mixer API is not available */
+MixerBackendDefinition mixerbackend_oss4 =
+{
+	"oss4",
+	_oss4_init,
+	NULL,
+	NULL,
+	NULL,
+	NULL,
+	NULL,
+	NULL,
+	NULL,
+	NULL,
+	NULL
+};
+
+
+/* private */
+/* functions */
+/* oss4_init */
+static MixerBackend * _oss4_init(String const * device)
+{
+	(void) device;
+
+	errno = ENOTSUP;
+	return NULL;
+}
+# endif /* SNDCTL_MIX_EXTINFO */
+#endif /* !__NetBSD__ */
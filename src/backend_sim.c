@@ -0,0 +1,486 @@
+/* $Id$ */
+/* Copyright (c) 2020 Pierre Pronchery <khorben@defora.org> */
+/* This file is part of DeforaOS Desktop Mixer */
+/* All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include "backend.h"
+
+
+/* Simulated */
+/* private */
+/* types */
+typedef enum _SimOption
+{
+	SO_CHANGES = 0,
+	SO_CHANNELS,
+	SO_CLASSES,
+	SO_CONTROLS,
+	SO_COUNTER,
+	SO_LATENCY,
+	SO_UPDATES
+} SimOption;
+#define SO_LAST SO_UPDATES
+#define SO_COUNT (SO_LAST + 1)
+
+typedef struct _SimEntry
+{
+	MixerDeviceInfo info;
+	MixerValue value;
+
+	/* per control update counter, as with OSS4 */
+	unsigned int updates;
+	unsigned int updates_seen;
+} SimEntry;
+
+struct _MixerBackend
+{
+	unsigned long options[SO_COUNT];
+
+	SimEntry * entries;
+	size_t entries_cnt;
+
+	unsigned int modify_counter;
+	unsigned int modify_seen;
+	unsigned long ioctls;
+
+	/* for the external changes */
+	unsigned int seed;
+};
+
+
+/* prototypes */
+static MixerBackend * _sim_init(String const * device);
+static void _sim_destroy(MixerBackend * sim);
+
+static size_t _sim_get_count(MixerBackend * sim);
+static MixerDeviceInfo const * _sim_get_info(MixerBackend * sim,
+		size_t position);
+static int _sim_get_changed(MixerBackend * sim, size_t position);
+static unsigned long _sim_get_ioctls(MixerBackend * sim);
+static int _sim_get_modified(MixerBackend * sim);
+static int _sim_get_properties(MixerBackend * sim,
+		MixerProperties * properties, char const ** error);
+static int _sim_get_value(MixerBackend * sim, size_t position,
+		MixerValue * value, char const ** error);
+
+static int _sim_set_value(MixerBackend * sim, size_t position,
+		MixerValue const * value, char const ** error);
+
+static void _sim_call(MixerBackend * sim);
+static void _sim_change(MixerBackend * sim);
+
+
+/* constants */
+static const struct
+{
+	String const * name;
+	unsigned long value;
+	unsigned long max;
+} _sim_options[SO_COUNT] =
+{
+	/* controls changed externally, on every refresh */
+	{ "changes",	0,	65536		},
+	{ "channels",	2,	MIXERDEVICE_CHANNELS_MAX	},
+	{ "classes",	3,	1024		},
+	{ "controls",	16,	65536		},
+	{ "counter",	1,	1		},
+	/* in microseconds, for every call */
+	{ "latency",	0,	1000000		},
+	{ "updates",	1,	1		}
+};
+
+static String const * _sim_classes[] =
+{
+	"outputs", "inputs", "record"
+};
+
+
+/* public */
+/* variables */
+MixerBackendDefinition mixerbackend_sim =
+{
+	"sim",
+	_sim_init,
+	_sim_destroy,
+	_sim_get_count,
+	_sim_get_info,
+	_sim_get_properties,
+	_sim_get_value,
+	_sim_set_value,
+	_sim_get_modified,
+	_sim_get_changed,
+	_sim_get_ioctls
+};
+
+
+/* private */
+/* functions */
+/* sim_init */
+static int _init_options(MixerBackend * sim, String const * options);
+static int _init_entries(MixerBackend * sim);
+
+static MixerBackend * _sim_init(String const * device)
+{
+	MixerBackend * sim;
+	int error;
+
+	if((sim = malloc(sizeof(*sim))) == NULL)
+		return NULL;
+	sim->entries = NULL;
+	sim->entries_cnt = 0;
+	sim->modify_counter = 0;
+	sim->modify_seen = 0;
+	sim->ioctls = 0;
+	sim->seed = 1;
+	if(_init_options(sim, device) != 0 || _init_entries(sim) != 0)
+	{
+		error = errno;
+		_sim_destroy(sim);
+		errno = error;
+		return NULL;
+	}
+	return sim;
+}
+
+static int _init_options(MixerBackend * sim, String const * options)
+{
+	String const * p;
+	char * q;
+	size_t i;
+	size_t len = 0;
+	unsigned long value;
+
+	for(i = 0; i < SO_COUNT; i++)
+		sim->options[i] = _sim_options[i].value;
+	/* the options are given as in "controls=1000,latency=100" */
+	for(p = options; p != NULL && *p != '\0'; p = (*q == ',') ? q + 1 : q)
+	{
+		for(i = 0; i < SO_COUNT; i++)
+			if(strncmp(p, _sim_options[i].name, len = strlen(
+							_sim_options[i].name))
+					== 0 && p[len] == '=')
+				break;
+		if(i == SO_COUNT)
+		{
+			errno = EINVAL;
+			return -1;
+		}
+		value = strtoul(&p[len + 1], &q, 10);
+		if(q == &p[len + 1] || (*q != ',' && *q != '\0')
+				|| value > _sim_options[i].max)
+		{
+			errno = EINVAL;
+			return -1;
+		}
+		sim->options[i] = value;
+	}
+	return 0;
+}
+
+static int _init_entries(MixerBackend * sim)
+{
+	size_t classes = sim->options[SO_CLASSES];
+	size_t controls = sim->options[SO_CONTROLS];
+	size_t groups = (controls + 3) / 4;
+	size_t i;
+	size_t j;
+	SimEntry * entry;
+	MixerDeviceInfo * info;
+
+	sim->entries_cnt = classes + controls;
+	if((sim->entries = calloc(sim->entries_cnt, sizeof(*sim->entries)))
+			== NULL)
+		return -1;
+	for(i = 0; i < classes; i++)
+	{
+		info = &sim->entries[i].info;
+		info->type = MDT_CLASS;
+		info->mixer_class = -1;
+		if(i < sizeof(_sim_classes) / sizeof(*_sim_classes))
+			snprintf(info->name, sizeof(info->name), "%s",
+					_sim_classes[i]);
+		else
+			snprintf(info->name, sizeof(info->name), "class%u",
+					(unsigned int)i);
+	}
+	/* the classes hold consecutive controls, as a value followed by its
+	 * mute switch, another value and a set */
+	for(i = 0; i < controls; i++)
+	{
+		entry = &sim->entries[classes + i];
+		/* the controls have not been read yet */
+		entry->updates = 1;
+		info = &entry->info;
+		info->mixer_class = (classes > 0) ? (int)(((i / 4) * classes)
+				/ groups) : -1;
+		switch(i % 4)
+		{
+			case 1:
+				info->type = MDT_ENUM;
+				snprintf(info->name, sizeof(info->name),
+						"control%u.mute",
+						(unsigned int)(i - 1));
+				snprintf(info->members[0].name,
+						sizeof(info->members[0].name),
+						"%s", "off");
+				info->members[0].value = 0;
+				snprintf(info->members[1].name,
+						sizeof(info->members[1].name),
+						"%s", "on");
+				info->members[1].value = 1;
+				info->members_cnt = 2;
+				entry->value.ord = 0;
+				break;
+			case 3:
+				info->type = MDT_SET;
+				snprintf(info->name, sizeof(info->name),
+						"select%u", (unsigned int)i);
+				for(j = 0; j < 3; j++)
+				{
+					snprintf(info->members[j].name,
+						sizeof(info->members[j].name),
+						"source%u", (unsigned int)j);
+					info->members[j].value = 1 << j;
+				}
+				info->members_cnt = j;
+				entry->value.mask = 1;
+				break;
+			default:
+				info->type = MDT_VALUE;
+				snprintf(info->name, sizeof(info->name),
+						"control%u", (unsigned int)i);
+				info->channels_cnt = sim->options[SO_CHANNELS];
+				info->delta = 1;
+				entry->value.level.channels_cnt
+					= info->channels_cnt;
+				entry->value.level.delta = info->delta;
+				for(j = 0; j < info->channels_cnt; j++)
+					entry->value.level.channels[j] = 50;
+				break;
+		}
+	}
+	return 0;
+}
+
+
+/* sim_destroy */
+static void _sim_destroy(MixerBackend * sim)
+{
+	free(sim->entries);
+	free(sim);
+}
+
+
+/* accessors */
+/* sim_get_changed */
+static int _sim_get_changed(MixerBackend * sim, size_t position)
+{
+	SimEntry * entry;
+
+	/* behave like a driver without any update counter */
+	if(sim->options[SO_UPDATES] == 0 || position >= sim->entries_cnt)
+		return 1;
+	_sim_call(sim);
+	entry = &sim->entries[position];
+	return (entry->updates != entry->updates_seen) ? 1 : 0;
+}
+
+
+/* sim_get_count */
+static size_t _sim_get_count(MixerBackend * sim)
+{
+	return sim->entries_cnt;
+}
+
+
+/* sim_get_info */
+static MixerDeviceInfo const * _sim_get_info(MixerBackend * sim,
+		size_t position)
+{
+	if(position >= sim->entries_cnt)
+		return NULL;
+	return &sim->entries[position].info;
+}
+
+
+/* sim_get_ioctls */
+static unsigned long _sim_get_ioctls(MixerBackend * sim)
+{
+	return sim->ioctls;
+}
+
+
+/* sim_get_modified */
+static int _sim_get_modified(MixerBackend * sim)
+{
+	_sim_change(sim);
+	/* behave like a driver without a counter */
+	if(sim->options[SO_COUNTER] == 0)
+		return 1;
+	_sim_call(sim);
+	if(sim->modify_counter == sim->modify_seen)
+		return 0;
+	sim->modify_seen = sim->modify_counter;
+	return 1;
+}
+
+
+/* sim_get_properties */
+static int _sim_get_properties(MixerBackend * sim,
+		MixerProperties * properties, char const ** error)
+{
+	(void) error;
+
+	_sim_call(sim);
+	snprintf(properties->name, sizeof(properties->name), "%s",
+			"Simulated");
+	snprintf(properties->version, sizeof(properties->version), "%s",
+			"1.0");
+	snprintf(properties->device, sizeof(properties->device), "%s",
+			mixerbackend_sim.name);
+	return 0;
+}
+
+
+/* sim_get_value */
+static int _sim_get_value(MixerBackend * sim, size_t position,
+		MixerValue * value, char const ** error)
+{
+	_sim_call(sim);
+	if(position >= sim->entries_cnt
+			|| sim->entries[position].info.type == MDT_CLASS)
+	{
+		*error = "read";
+		return -ENXIO;
+	}
+	*value = sim->entries[position].value;
+	sim->entries[position].updates_seen = sim->entries[position].updates;
+	return 0;
+}
+
+
+/* sim_set_value */
+static int _sim_set_value(MixerBackend * sim, size_t position,
+		MixerValue const * value, char const ** error)
+{
+	SimEntry * entry;
+	size_t i;
+
+	_sim_call(sim);
+	if(position >= sim->entries_cnt
+			|| sim->entries[position].info.type == MDT_CLASS)
+	{
+		*error = "write";
+		return -ENXIO;
+	}
+	entry = &sim->entries[position];
+	switch(entry->info.type)
+	{
+		case MDT_ENUM:
+			entry->value.ord = value->ord;
+			break;
+		case MDT_SET:
+			entry->value.mask = value->mask;
+			break;
+		default:
+			for(i = 0; i < entry->info.channels_cnt
+					&& i < value->level.channels_cnt; i++)
+				entry->value.level.channels[i]
+					= value->level.channels[i];
+			break;
+	}
+	entry->updates++;
+	sim->modify_counter++;
+	return 0;
+}
+
+
+/* useful */
+/* sim_call */
+static void _sim_call(MixerBackend * sim)
+{
+	struct timespec ts;
+
+	sim->ioctls++;
+	if(sim->options[SO_LATENCY] == 0)
+		return;
+	ts.tv_sec = sim->options[SO_LATENCY] / 1000000;
+	ts.tv_nsec = (sim->options[SO_LATENCY] % 1000000) * 1000;
+	nanosleep(&ts, NULL);
+}
+
+
+/* sim_change */
+static void _sim_change(MixerBackend * sim)
+{
+	size_t classes = sim->options[SO_CLASSES];
+	size_t controls = sim->options[SO_CONTROLS];
+	size_t changes = sim->options[SO_CHANGES];
+	size_t i;
+	size_t j;
+	size_t k;
+	unsigned int level;
+	SimEntry * entry;
+
+	if(changes == 0 || controls == 0)
+		return;
+	/* as many distinct controls, following a random one */
+	i = rand_r(&sim->seed) % controls;
+	for(k = 0; k < controls && changes > 0; k++, i = (i + 1) % controls)
+	{
+		entry = &sim->entries[classes + i];
+		switch(entry->info.type)
+		{
+			case MDT_SET:
+				entry->value.mask ^= entry->info.members[
+					rand_r(&sim->seed)
+					% entry->info.members_cnt].value;
+				break;
+			case MDT_VALUE:
+				/* every level moves */
+				for(j = 0; j < entry->info.channels_cnt; j++)
+				{
+					level = entry->value.level.channels[j]
+						+ 1 + rand_r(&sim->seed) % 100;
+					entry->value.level.channels[j] = level % 101;
+				}
+				break;
+			default:
+				/* the mute switches are shown with their level */
+				continue;
+		}
+		entry->updates++;
+		sim->modify_counter++;
+		changes--;
+	}
+}
@@ -0,0 +1,506 @@
+/* $Id$ */
+/* Copyright (c) 2020 Pierre Pronchery <khorben@defora.org> */
+/* This file is part of DeforaOS Desktop Mixer */
+/* All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include "backend.h"
+#include "trace.h"
+
+/* compatibility */
+#ifndef EFTYPE
+# define EFTYPE	EINVAL
+#endif
+
+
+/* Trace */
+/* private */
+/* types */
+typedef struct _TraceCall
+{
+	int ret;
+	uint32_t duration;
+	MixerValue value;
+	/* the next call of the same type on the same control */
+	size_t next;
+} TraceCall;
+
+typedef struct _TraceEntry
+{
+	MixerDeviceInfo info;
+	MixerValue value;
+
+	/* the next calls to replay, and the last ones recorded */
+	size_t changed;
+	size_t changed_last;
+	size_t read;
+	size_t read_last;
+	size_t write;
+	size_t write_last;
+} TraceEntry;
+
+struct _MixerBackend
+{
+	/* replay the duration of the calls as recorded */
+	int timing;
+
+	TraceEntry * entries;
+	size_t entries_cnt;
+
+	TraceCall * calls;
+	size_t calls_cnt;
+
+	int properties_ret;
+	uint32_t properties_duration;
+	MixerProperties properties;
+
+	size_t modified;
+	size_t modified_last;
+	unsigned int modify_counter;
+	unsigned int modify_seen;
+
+	unsigned long ioctls;
+};
+
+
+/* constants */
+#define TRACE_END	((size_t)-1)
+
+
+/* prototypes */
+static MixerBackend * _trace_init(String const * device);
+static void _trace_destroy(MixerBackend * trace);
+
+static int _trace_get_changed(MixerBackend * trace, size_t position);
+static size_t _trace_get_count(MixerBackend * trace);
+static MixerDeviceInfo const * _trace_get_info(MixerBackend * trace,
+		size_t position);
+static unsigned long _trace_get_ioctls(MixerBackend * trace);
+static int _trace_get_modified(MixerBackend * trace);
+static int _trace_get_properties(MixerBackend * trace,
+		MixerProperties * properties, char const ** error);
+static int _trace_get_value(MixerBackend * trace, size_t position,
+		MixerValue * value, char const ** error);
+
+static int _trace_set_value(MixerBackend * trace, size_t position,
+		MixerValue const * value, char const ** error);
+
+static TraceCall * _trace_call(MixerBackend * trace, size_t * cursor);
+
+
+/* public */
+/* variables */
+MixerBackendDefinition mixerbackend_trace =
+{
+	"trace",
+	_trace_init,
+	_trace_destroy,
+	_trace_get_count,
+	_trace_get_info,
+	_trace_get_properties,
+	_trace_get_value,
+	_trace_set_value,
+	_trace_get_modified,
+	_trace_get_changed,
+	_trace_get_ioctls
+};
+
+
+/* private */
+/* functions */
+/* trace_init */
+static int _init_load(MixerBackend * trace, String const * filename);
+static int _init_load_classes(MixerBackend * trace);
+static int _init_load_record(MixerBackend * trace,
+		MixerTraceRecord const * record, MixerTraceData const * data);
+
+static MixerBackend * _trace_init(String const * device)
+{
+	MixerBackend * trace;
+	int error;
+
+	if((trace = malloc(sizeof(*trace))) == NULL)
+		return NULL;
+	trace->timing = 0;
+	trace->entries = NULL;
+	trace->entries_cnt = 0;
+	trace->calls = NULL;
+	trace->calls_cnt = 0;
+	trace->properties_ret = -ENOTSUP;
+	trace->properties_duration = 0;
+	memset(&trace->properties, 0, sizeof(trace->properties));
+	trace->modified = TRACE_END;
+	trace->modified_last = TRACE_END;
+	trace->modify_counter = 0;
+	trace->modify_seen = 0;
+	trace->ioctls = 0;
+	/* the trace is given as in "timing=1,file=mixer.trace" or directly */
+	if(strncmp(device, "timing=", 7) == 0)
+	{
+		trace->timing = (device[7] == '1') ? 1 : 0;
+		if((device = strchr(device, ',')) == NULL
+				|| strncmp(++device, "file=", 5) != 0)
+		{
+			free(trace);
+			errno = EINVAL;
+			return NULL;
+		}
+	}
+	if(strncmp(device, "file=", 5) == 0)
+		device += 5;
+	if(_init_load(trace, device) != 0)
+	{
+		error = errno;
+		_trace_destroy(trace);
+		errno = error;
+		return NULL;
+	}
+	return trace;
+}
+
+static int _init_load(MixerBackend * trace, String const * filename)
+{
+	int ret;
+	FILE * fp;
+	MixerTraceRecord record;
+	MixerTraceData data;
+	int error;
+
+	if((fp = fopen(filename, "rb")) == NULL)
+		return -1;
+	if((ret = mixertrace_read_header(fp)) == 0)
+		while((ret = mixertrace_read_record(fp, &record, &data)) == 0)
+			if((ret = _init_load_record(trace, &record, &data))
+					!= 0)
+				break;
+	if(ret == 1)
+		ret = (_init_load_classes(trace) == 0) ? 1 : -1;
+	error = errno;
+	fclose(fp);
+	errno = error;
+	return (ret == 1) ? 0 : -1;
+}
+
+static int _init_load_classes(MixerBackend * trace)
+{
+	size_t i;
+	int c;
+
+	/* the classes may follow their controls, as on NetBSD */
+	for(i = 0; i < trace->entries_cnt; i++)
+	{
+		if((c = trace->entries[i].info.mixer_class) == -1)
+			continue;
+		if(c < 0 || (size_t)c >= trace->entries_cnt
+				|| trace->entries[c].info.type != MDT_CLASS)
+		{
+			errno = EFTYPE;
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int _init_load_record(MixerBackend * trace,
+		MixerTraceRecord const * record, MixerTraceData const * data)
+{
+	TraceEntry * entry;
+	TraceCall * call;
+	size_t * first;
+	size_t * last;
+
+	if(record->type == MTT_INFO)
+	{
+		/* the controls come first, in order */
+		if(record->position != trace->entries_cnt
+				|| record->ret != 0)
+		{
+			errno = EFTYPE;
+			return -1;
+		}
+		if((entry = realloc(trace->entries, sizeof(*entry)
+						* (trace->entries_cnt + 1)))
+				== NULL)
+			return -1;
+		trace->entries = entry;
+		entry = &trace->entries[trace->entries_cnt++];
+		entry->info = data->info;
+		memset(&entry->value, 0, sizeof(entry->value));
+		entry->value.level.channels_cnt = entry->info.channels_cnt;
+		entry->value.level.delta = entry->info.delta;
+		entry->changed = TRACE_END;
+		entry->changed_last = TRACE_END;
+		entry->read = TRACE_END;
+		entry->read_last = TRACE_END;
+		entry->write = TRACE_END;
+		entry->write_last = TRACE_END;
+		return 0;
+	}
+	if(record->type == MTT_PROPERTIES)
+	{
+		/* only the first one is replayed */
+		if(trace->properties_ret == -ENOTSUP)
+		{
+			trace->properties_ret = record->ret;
+			trace->properties_duration = record->duration;
+			if(record->ret == 0)
+				trace->properties = data->properties;
+		}
+		return 0;
+	}
+	if(record->type == MTT_MODIFIED)
+	{
+		first = &trace->modified;
+		last = &trace->modified_last;
+	}
+	else if(record->position >= trace->entries_cnt)
+	{
+		errno = EFTYPE;
+		return -1;
+	}
+	else if(record->type == MTT_CHANGED)
+	{
+		entry = &trace->entries[record->position];
+		first = &entry->changed;
+		last = &entry->changed_last;
+	}
+	else
+	{
+		entry = &trace->entries[record->position];
+		first = (record->type == MTT_READ) ? &entry->read
+			: &entry->write;
+		last = (record->type == MTT_READ) ? &entry->read_last
+			: &entry->write_last;
+		/* the controls start with the first value read */
+		if(record->type == MTT_READ && record->ret == 0
+				&& entry->read == TRACE_END)
+			entry->value = data->value;
+	}
+	if((call = realloc(trace->calls, sizeof(*call)
+					* (trace->calls_cnt + 1))) == NULL)
+		return -1;
+	trace->calls = call;
+	call = &trace->calls[trace->calls_cnt];
+	call->ret = record->ret;
+	call->duration = record->duration;
+	if(record->type == MTT_MODIFIED || record->type == MTT_CHANGED
+			|| record->ret != 0)
+		memset(&call->value, 0, sizeof(call->value));
+	else
+		call->value = data->value;
+	call->next = TRACE_END;
+	if(*last == TRACE_END)
+		*first = trace->calls_cnt;
+	else
+		trace->calls[*last].next = trace->calls_cnt;
+	*last = trace->calls_cnt++;
+	return 0;
+}
+
+
+/* trace_destroy */
+static void _trace_destroy(MixerBackend * trace)
+{
+	free(trace->calls);
+	free(trace->entries);
+	free(trace);
+}
+
+
+/* accessors */
+/* trace_get_changed */
+static int _trace_get_changed(MixerBackend * trace, size_t position)
+{
+	TraceCall * call;
+
+	if(position >= trace->entries_cnt)
+		return 1;
+	if((call = _trace_call(trace, &trace->entries[position].changed))
+			!= NULL)
+		return call->ret;
+	/* past the end of the trace, or if never recorded */
+	return 1;
+}
+
+
+/* trace_get_count */
+static size_t _trace_get_count(MixerBackend * trace)
+{
+	return trace->entries_cnt;
+}
+
+
+/* trace_get_info */
+static MixerDeviceInfo const * _trace_get_info(MixerBackend * trace,
+		size_t position)
+{
+	if(position >= trace->entries_cnt)
+		return NULL;
+	return &trace->entries[position].info;
+}
+
+
+/* trace_get_ioctls */
+static unsigned long _trace_get_ioctls(MixerBackend * trace)
+{
+	return trace->ioctls;
+}
+
+
+/* trace_get_modified */
+static int _trace_get_modified(MixerBackend * trace)
+{
+	TraceCall * call;
+
+	if((call = _trace_call(trace, &trace->modified)) != NULL)
+		return call->ret;
+	/* past the end of the trace, report the writes replayed */
+	if(trace->modify_counter == trace->modify_seen)
+		return 0;
+	trace->modify_seen = trace->modify_counter;
+	return 1;
+}
+
+
+/* trace_get_properties */
+static int _trace_get_properties(MixerBackend * trace,
+		MixerProperties * properties, char const ** error)
+{
+	_trace_call(trace, NULL);
+	if(trace->properties_ret != 0)
+	{
+		*error = "properties";
+		return trace->properties_ret;
+	}
+	*properties = trace->properties;
+	return 0;
+}
+
+
+/* trace_get_value */
+static int _trace_get_value(MixerBackend * trace, size_t position,
+		MixerValue * value, char const ** error)
+{
+	TraceEntry * entry;
+	TraceCall * call;
+
+	if(position >= trace->entries_cnt
+			|| trace->entries[position].info.type == MDT_CLASS)
+	{
+		*error = "read";
+		return -ENXIO;
+	}
+	entry = &trace->entries[position];
+	/* replay the values read, then keep the last one known */
+	if((call = _trace_call(trace, &entry->read)) != NULL)
+	{
+		if(call->ret != 0)
+		{
+			*error = "read";
+			return call->ret;
+		}
+		entry->value = call->value;
+	}
+	*value = entry->value;
+	return 0;
+}
+
+
+/* trace_set_value */
+static int _trace_set_value(MixerBackend * trace, size_t position,
+		MixerValue const * value, char const ** error)
+{
+	TraceEntry * entry;
+	TraceCall * call;
+	size_t i;
+
+	if(position >= trace->entries_cnt
+			|| trace->entries[position].info.type == MDT_CLASS)
+	{
+		*error = "write";
+		return -ENXIO;
+	}
+	entry = &trace->entries[position];
+	if((call = _trace_call(trace, &entry->write)) != NULL
+			&& call->ret != 0)
+	{
+		*error = "write";
+		return call->ret;
+	}
+	switch(entry->info.type)
+	{
+		case MDT_ENUM:
+			entry->value.ord = value->ord;
+			break;
+		case MDT_SET:
+			entry->value.mask = value->mask;
+			break;
+		default:
+			for(i = 0; i < entry->value.level.channels_cnt
+					&& i < value->level.channels_cnt; i++)
+				entry->value.level.channels[i]
+					= value->level.channels[i];
+			break;
+	}
+	trace->modify_counter++;
+	return 0;
+}
+
+
+/* useful */
+/* trace_call */
+static TraceCall * _trace_call(MixerBackend * trace, size_t * cursor)
+{
+	TraceCall * call = NULL;
+	uint32_t duration;
+	struct timespec ts;
+
+	trace->ioctls++;
+	/* the properties are replayed without any cursor */
+	if(cursor == NULL)
+		duration = trace->properties_duration;
+	else if(*cursor != TRACE_END)
+	{
+		call = &trace->calls[*cursor];
+		*cursor = call->next;
+		duration = call->duration;
+	}
+	else
+		duration = 0;
+	if(trace->timing == 0 || duration == 0)
+		return call;
+	ts.tv_sec = duration / 1000000;
+	ts.tv_nsec = (duration % 1000000) * 1000;
+	nanosleep(&ts, NULL);
+	return call;
+}
@@ -28,9 +28,8 @@
 
 
 
-#ifdef DEBUG
-# include <stdio.h>
-#endif
+#include <stdlib.h>
+#include <stdio.h>
 #include <System/object.h>
 #include <System/plugin.h>
 #include <Desktop.h>
@@ -42,6 +41,15 @@
 
 /* private */
 /* types */
+typedef struct _MixerControlType
+{
+	String * type;
+	Plugin * handle;
+	MixerControlDefinition * definition;
+	MixerControlDefinition2 * definition2;
+	unsigned int refcount;
+} MixerControlType;
+
 struct _MixerControl
 {
 	Mixer * mixer;
@@ -49,8 +57,10 @@ struct _MixerControl
 	MixerControlPluginHelper helper;
 
 	String * id;
-	Plugin * handle;
+	size_t index;
+	MixerControlType * type;
 	MixerControlDefinition * definition;
+	MixerControlDefinition2 * definition2;
 	MixerControlPlugin * plugin;
 	GtkWidget * widget;
 
@@ -65,6 +75,47 @@ struct _MixerControl
 /* helper */
 static int _mixercontrol_helper_set(MixerControl * control);
 
+/* useful */
+static MixerControlType * _mixercontrol_type_get(String const * type);
+static void _mixercontrol_type_put(MixerControlType * type);
+
+
+/* variables */
+/* the plugins are shared by every control of the same type */
+static MixerControlType ** _mixercontrol_types = NULL;
+static size_t _mixercontrol_types_cnt = 0;
+static unsigned long _mixercontrol_loaded = 0;
+
+/* the names of the properties, for the plugins implementing version 1 */
+static String const * _mixercontrol_properties[MCP_COUNT] =
+{
+	"bind", "channels", "delta", "members", "mute", "show-bind",
+	"show-mute", "value"
+};
+
+#ifdef EMBEDDED
+/* built-in controls */
+extern MixerControlDefinition2 control_channels2;
+extern MixerControlDefinition2 control_meter2;
+extern MixerControlDefinition control_mute;
+extern MixerControlDefinition control_radio;
+extern MixerControlDefinition control_set;
+
+static const struct
+{
+	String const * type;
+	MixerControlDefinition * definition;
+	MixerControlDefinition2 * definition2;
+} _mixercontrol_builtins[] =
+{
+	{ "channels",	&control_channels2.definition,	&control_channels2 },
+	{ "meter",	&control_meter2.definition,	&control_meter2	   },
+	{ "mute",	&control_mute,			NULL		   },
+	{ "radio",	&control_radio,			NULL		   },
+	{ "set",	&control_set,			NULL		   }
+};
+#endif
+
 
 /* public */
 /* functions */
@@ -87,15 +138,17 @@ MixerControl * mixercontrol_new(Mixer * mixer, String const * id,
 	control->helper.control = control;
 	control->helper.mixercontrol_set = _mixercontrol_helper_set;
 	control->id = string_new(id);
-	control->handle = plugin_new(LIBDIR, PACKAGE, "controls", type);
-	control->definition = NULL;
+	control->index = (size_t)-1;
+	control->type = _mixercontrol_type_get(type);
+	control->definition = (control->type != NULL)
+		? control->type->definition : NULL;
+	control->definition2 = (control->type != NULL)
+		? control->type->definition2 : NULL;
 	control->plugin = NULL;
 	control->frame = NULL;
 	va_start(ap, type);
 	if(control->id == NULL
-			|| control->handle == NULL
-			|| (control->definition = plugin_lookup(control->handle,
-					"control")) == NULL
+			|| control->definition == NULL
 			|| control->definition->init == NULL
 			|| control->definition->destroy == NULL
 			|| (control->plugin = control->definition->init(
@@ -107,7 +160,8 @@ MixerControl * mixercontrol_new(Mixer * mixer, String const * id,
 		va_end(ap);
 #ifdef DEBUG
 		fprintf(stderr, "DEBUG: %s() => NULL %p %p\n", __func__,
-				control->handle, control->definition);
+				(void *)control->type,
+				(void *)control->definition);
 #endif
 		mixercontrol_delete(control);
 		return NULL;
@@ -138,8 +192,8 @@ void mixercontrol_delete(MixerControl * control)
 {
 	if(control->plugin != NULL && control->definition->destroy != NULL)
 		control->definition->destroy(control->plugin);
-	if(control->handle != NULL)
-		plugin_delete(control->handle);
+	if(control->type != NULL)
+		_mixercontrol_type_put(control->type);
 	if(control->id != NULL)
 		string_delete(control->id);
 	object_delete(control);
@@ -165,6 +219,30 @@ int mixercontrol_get(MixerControl * control, ...)
 }
 
 
+/* mixercontrol_get_levels */
+int mixercontrol_get_levels(MixerControl * control, uint8_t * levels,
+		size_t levels_cnt)
+{
+	size_t i;
+	char name[16];
+	double value;
+
+	if(control->definition2 != NULL
+			&& control->definition2->get_levels != NULL)
+		return control->definition2->get_levels(control->plugin,
+				levels, levels_cnt);
+	for(i = 0; i < levels_cnt; i++)
+	{
+		snprintf(name, sizeof(name), "value%zu", i);
+		if(mixercontrol_get(control, name, &value, NULL) != 0)
+			return -1;
+		levels[i] = (value <= 0.0) ? 0
+			: ((value >= 100.0) ? 100 : value + 0.5);
+	}
+	return 0;
+}
+
+
 /* mixercontrol_get_id */
 String const * mixercontrol_get_id(MixerControl * control)
 {
@@ -172,6 +250,44 @@ String const * mixercontrol_get_id(MixerControl * control)
 }
 
 
+/* mixercontrol_get_loaded */
+unsigned long mixercontrol_get_loaded(void)
+{
+	return _mixercontrol_loaded;
+}
+
+
+/* mixercontrol_get_index */
+size_t mixercontrol_get_index(MixerControl * control)
+{
+	return control->index;
+}
+
+
+/* mixercontrol_get_property */
+int mixercontrol_get_property(MixerControl * control,
+		MixerControlProperty property, unsigned int * value)
+{
+	int ret;
+	size_t zu = 0;
+
+	if(property > MCP_LAST)
+		return -1;
+	if(control->definition2 != NULL
+			&& control->definition2->get_property != NULL)
+		return control->definition2->get_property(control->plugin,
+				property, value);
+	if(property != MCP_CHANNELS)
+		return mixercontrol_get(control,
+				_mixercontrol_properties[property], value,
+				NULL);
+	/* the number of channels used to be obtained as a size_t */
+	if((ret = mixercontrol_get(control, "channels", &zu, NULL)) == 0)
+		*value = zu;
+	return ret;
+}
+
+
 /* mixercontrol_get_type */
 String const * mixercontrol_get_type(MixerControl * control)
 {
@@ -202,6 +318,55 @@ int mixercontrol_set(MixerControl * control, ...)
 }
 
 
+/* mixercontrol_set_levels */
+int mixercontrol_set_levels(MixerControl * control, uint8_t const * levels,
+		size_t levels_cnt)
+{
+	size_t i;
+	char name[16];
+	gdouble value;
+
+	if(control->definition2 != NULL
+			&& control->definition2->set_levels != NULL)
+		return control->definition2->set_levels(control->plugin,
+				levels, levels_cnt);
+	for(i = 0; i < levels_cnt; i++)
+	{
+		snprintf(name, sizeof(name), "value%zu", i);
+		value = levels[i];
+		if(mixercontrol_set(control, name, value, NULL) != 0)
+			return -1;
+	}
+	return 0;
+}
+
+
+/* mixercontrol_set_property */
+int mixercontrol_set_property(MixerControl * control,
+		MixerControlProperty property, unsigned int value)
+{
+	if(property > MCP_LAST)
+		return -1;
+	if(control->definition2 != NULL
+			&& control->definition2->set_property != NULL)
+		return control->definition2->set_property(control->plugin,
+				property, value);
+	/* the number of channels used to be given as a size_t */
+	if(property == MCP_CHANNELS)
+		return mixercontrol_set(control, "channels", (size_t)value,
+				NULL);
+	return mixercontrol_set(control, _mixercontrol_properties[property],
+			value, NULL);
+}
+
+
+/* mixercontrol_set_index */
+void mixercontrol_set_index(MixerControl * control, size_t index)
+{
+	control->index = index;
+}
+
+
 /* mixercontrol_set_icon */
 void mixercontrol_set_icon(MixerControl * control, String const * icon)
 {
@@ -233,3 +398,103 @@ static int _mixercontrol_helper_set(MixerControl * control)
 #endif
 	return mixer_set(control->mixer, control);
 }
+
+
+/* useful */
+/* mixercontrol_type_get */
+static MixerControlType * _mixercontrol_type_get(String const * type)
+{
+	MixerControlType ** p;
+	MixerControlType * t;
+	size_t i;
+
+	for(i = 0; i < _mixercontrol_types_cnt; i++)
+		if(string_compare(_mixercontrol_types[i]->type, type) == 0)
+		{
+			_mixercontrol_types[i]->refcount++;
+			return _mixercontrol_types[i];
+		}
+	if((p = realloc(_mixercontrol_types, sizeof(*p)
+					* (_mixercontrol_types_cnt + 1))) == NULL)
+		return NULL;
+	_mixercontrol_types = p;
+	if((t = object_new(sizeof(*t))) == NULL)
+		return NULL;
+	if((t->type = string_new(type)) == NULL)
+	{
+		object_delete(t);
+		return NULL;
+	}
+	t->handle = NULL;
+	t->definition = NULL;
+	t->definition2 = NULL;
+	t->refcount = 1;
+#ifdef EMBEDDED
+	for(i = 0; i < sizeof(_mixercontrol_builtins)
+			/ sizeof(*_mixercontrol_builtins); i++)
+		if(string_compare(_mixercontrol_builtins[i].type, type) == 0)
+		{
+			t->definition = _mixercontrol_builtins[i].definition;
+			t->definition2 = _mixercontrol_builtins[i].definition2;
+			break;
+		}
+#endif
+	/* fallback to the external plugins */
+	if(t->definition == NULL)
+	{
+		if((t->handle = plugin_new(LIBDIR, PACKAGE, "controls", type))
+				!= NULL && (t->definition2 = plugin_lookup(
+						t->handle, "control2")) != NULL)
+		{
+			/* the newer versions extend the previous ones */
+			if(t->definition2->version >= 2)
+				t->definition = &t->definition2->definition;
+			else
+				t->definition2 = NULL;
+		}
+		if(t->handle == NULL || (t->definition == NULL
+					&& (t->definition = plugin_lookup(
+							t->handle, "control"))
+					== NULL))
+		{
+			if(t->handle != NULL)
+				plugin_delete(t->handle);
+			string_delete(t->type);
+			object_delete(t);
+			return NULL;
+		}
+		_mixercontrol_loaded++;
+	}
+#ifdef DEBUG
+	fprintf(stderr, "DEBUG: %s(\"%s\") %s\n", __func__, type,
+			(t->handle != NULL) ? "loaded" : "built-in");
+#endif
+	_mixercontrol_types[_mixercontrol_types_cnt++] = t;
+	return t;
+}
+
+
+/* mixercontrol_type_put */
+static void _mixercontrol_type_put(MixerControlType * type)
+{
+	size_t i;
+
+	if(--type->refcount > 0)
+		return;
+	for(i = 0; i < _mixercontrol_types_cnt; i++)
+		if(_mixercontrol_types[i] == type)
+		{
+			_mixercontrol_types[i]
+				= _mixercontrol_types[--_mixercontrol_types_cnt];
+			break;
+		}
+	if(_mixercontrol_types_cnt == 0)
+	{
+		free(_mixercontrol_types);
+		_mixercontrol_types = NULL;
+	}
+	if(type->handle != NULL)
+		plugin_delete(type->handle);
+	string_delete(type->type);
+	object_delete(type);
+}
@@ -31,8 +31,10 @@
 #ifndef MIXER_CONTROL_H
 # define MIXER_CONTROL_H
 
+# include <stdint.h>
 # include <gtk/gtk.h>
 # include <System/string.h>
+# include "Mixer/control.h"
 # include "common.h"
 
 
@@ -52,10 +54,21 @@ int mixercontrol_get(MixerControl * control, ...);
 int mixercontrol_set(MixerControl * control, ...);
 
 String const * mixercontrol_get_id(MixerControl * control);
+size_t mixercontrol_get_index(MixerControl * control);
+int mixercontrol_get_levels(MixerControl * control, uint8_t * levels,
+		size_t levels_cnt);
+unsigned long mixercontrol_get_loaded(void);
+int mixercontrol_get_property(MixerControl * control,
+		MixerControlProperty property, unsigned int * value);
 String const * mixercontrol_get_type(MixerControl * control);
 GtkWidget * mixercontrol_get_widget(MixerControl * control);
 
 void mixercontrol_set_icon(MixerControl * control, String const * icon);
+void mixercontrol_set_index(MixerControl * control, size_t index);
+int mixercontrol_set_levels(MixerControl * control, uint8_t const * levels,
+		size_t levels_cnt);
+int mixercontrol_set_property(MixerControl * control,
+		MixerControlProperty property, unsigned int value);
 
 /* useful */
 void mixercontrol_disable(MixerControl * control);
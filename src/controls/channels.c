@@ -85,11 +85,19 @@ static MixerControlPlugin * _channels_init(MixerControlPluginHelper * helper,
 static void _channels_destroy(MixerControlPlugin * channels);
 
 static int _channels_get(MixerControlPlugin * channels, va_list properties);
+static int _channels_get_levels(MixerControlPlugin * channels,
+		uint8_t * levels, size_t levels_cnt);
+static int _channels_get_property(MixerControlPlugin * channels,
+		MixerControlProperty property, unsigned int * value);
 
 static String const * _channels_get_type(MixerControlPlugin * channels);
 static GtkWidget * _channels_get_widget(MixerControlPlugin * channels);
 
 static int _channels_set(MixerControlPlugin * channels, va_list properties);
+static int _channels_set_levels(MixerControlPlugin * channels,
+		uint8_t const * levels, size_t levels_cnt);
+static int _channels_set_property(MixerControlPlugin * channels,
+		MixerControlProperty property, unsigned int value);
 
 /* callbacks */
 static void _channels_on_bind_toggled(gpointer data);
@@ -105,17 +113,28 @@ static void _channels_on_mute_toggled(gpointer data);
 
 /* public */
 /* variables */
-MixerControlDefinition control =
+#ifdef MIXER_BUILTIN
+MixerControlDefinition2 control_channels2 =
+#else
+MixerControlDefinition2 control2 =
+#endif
 {
-	NULL,
-	"Channels",
-	NULL,
-	_channels_init,
-	_channels_destroy,
-	_channels_get,
-	_channels_get_type,
-	_channels_get_widget,
-	_channels_set
+	MIXERCONTROL_VERSION,
+	{
+		NULL,
+		"Channels",
+		NULL,
+		_channels_init,
+		_channels_destroy,
+		_channels_get,
+		_channels_get_type,
+		_channels_get_widget,
+		_channels_set
+	},
+	_channels_get_property,
+	_channels_set_property,
+	_channels_get_levels,
+	_channels_set_levels
 };
 
 
@@ -278,6 +297,51 @@ static gboolean _get_mute(MixerControlPlugin * channels)
 }
 
 
+/* channels_get_levels */
+static int _channels_get_levels(MixerControlPlugin * channels,
+		uint8_t * levels, size_t levels_cnt)
+{
+	size_t i;
+	gdouble value;
+
+	if(levels_cnt > channels->channels_cnt)
+		return -1;
+	for(i = 0; i < levels_cnt; i++)
+	{
+		value = gtk_range_get_value(GTK_RANGE(
+					channels->channels[i].widget));
+		levels[i] = (value <= 0.0) ? 0
+			: ((value >= 100.0) ? 100 : value + 0.5);
+	}
+	return 0;
+}
+
+
+/* channels_get_property */
+static int _channels_get_property(MixerControlPlugin * channels,
+		MixerControlProperty property, unsigned int * value)
+{
+	switch(property)
+	{
+		case MCP_BIND:
+			*value = gtk_toggle_button_get_active(
+					GTK_TOGGLE_BUTTON(channels->bind));
+			return 0;
+		case MCP_CHANNELS:
+			*value = channels->channels_cnt;
+			return 0;
+		case MCP_DELTA:
+			*value = channels->delta;
+			return 0;
+		case MCP_MUTE:
+			*value = _get_mute(channels);
+			return 0;
+		default:
+			return -1;
+	}
+}
+
+
 /* channels_get_type */
 static String const * _channels_get_type(MixerControlPlugin * channels)
 {
@@ -459,6 +523,51 @@ static void _set_value_channel(MixerControlPlugin * channels,
 }
 
 
+/* channels_set_levels */
+static int _channels_set_levels(MixerControlPlugin * channels,
+		uint8_t const * levels, size_t levels_cnt)
+{
+	size_t i;
+
+	if(levels_cnt > channels->channels_cnt)
+		return -1;
+	for(i = 0; i < levels_cnt; i++)
+		_set_value_channel(channels, i, levels[i]);
+	return 0;
+}
+
+
+/* channels_set_property */
+static int _channels_set_property(MixerControlPlugin * channels,
+		MixerControlProperty property, unsigned int value)
+{
+	switch(property)
+	{
+		case MCP_BIND:
+			_set_bind(channels, value);
+			return 0;
+		case MCP_CHANNELS:
+			return _set_channels(channels, value);
+		case MCP_DELTA:
+			_set_delta(channels, value);
+			return 0;
+		case MCP_MUTE:
+			_set_mute(channels, value);
+			return 0;
+		case MCP_SHOW_BIND:
+			value ? gtk_widget_show(channels->bind)
+				: gtk_widget_hide(channels->bind);
+			return 0;
+		case MCP_SHOW_MUTE:
+			value ? gtk_widget_show(channels->mute)
+				: gtk_widget_hide(channels->mute);
+			return 0;
+		default:
+			return -1;
+	}
+}
+
+
 /* callbacks */
 /* channels_on_bind_toggled */
 static void _channels_on_bind_toggled(gpointer data)
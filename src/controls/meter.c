@@ -0,0 +1,787 @@
+/* $Id$ */
+/* Copyright (c) 2020 Pierre Pronchery <khorben@defora.org> */
+/* This file is part of DeforaOS Desktop Mixer */
+/* All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <libintl.h>
+#include <System/object.h>
+#include <Desktop.h>
+#include "Mixer/control.h"
+#define _(string) gettext(string)
+
+
+/* MixerControlMeter */
+/* private */
+/* constants */
+#define METER_BAR_WIDTH		12
+#define METER_HEIGHT		120
+#define METER_MUTE_HEIGHT	20
+#define METER_PAGE		10
+#define METER_SPACING		4
+
+
+/* types */
+struct _MixerControlPlugin
+{
+	MixerControlPluginHelper * helper;
+
+	/* a single widget draws every channel */
+	GtkWidget * widget;
+
+	unsigned int delta;
+	uint8_t * levels;
+	size_t levels_cnt;
+
+	gboolean bind;
+	gboolean mute;
+	gboolean show_mute;
+
+	/* the channel being dragged, if any */
+	int drag;
+	/* the channel adjusted with the keyboard */
+	int channel;
+};
+
+
+/* prototypes */
+/* control */
+static MixerControlPlugin * _meter_init(MixerControlPluginHelper * helper,
+		String const * type, va_list properties);
+static void _meter_destroy(MixerControlPlugin * meter);
+
+static int _meter_get(MixerControlPlugin * meter, va_list properties);
+static int _meter_get_levels(MixerControlPlugin * meter, uint8_t * levels,
+		size_t levels_cnt);
+static int _meter_get_property(MixerControlPlugin * meter,
+		MixerControlProperty property, unsigned int * value);
+static String const * _meter_get_type(MixerControlPlugin * meter);
+static GtkWidget * _meter_get_widget(MixerControlPlugin * meter);
+
+static int _meter_set(MixerControlPlugin * meter, va_list properties);
+static int _meter_set_levels(MixerControlPlugin * meter,
+		uint8_t const * levels, size_t levels_cnt);
+static int _meter_set_property(MixerControlPlugin * meter,
+		MixerControlProperty property, unsigned int value);
+
+/* useful */
+static void _meter_area(MixerControlPlugin * meter, int * x, int * top,
+		int * bottom);
+static void _meter_change(MixerControlPlugin * meter, int channel, int level);
+static int _meter_channel(MixerControlPlugin * meter, double x);
+static void _meter_draw(MixerControlPlugin * meter, cairo_t * cr, double red,
+		double green, double blue, double alpha);
+static int _meter_level(MixerControlPlugin * meter, double y);
+static void _meter_mute(MixerControlPlugin * meter);
+static void _meter_resize(MixerControlPlugin * meter);
+
+/* callbacks */
+static gboolean _meter_on_button_press(GtkWidget * widget,
+		GdkEventButton * event, gpointer data);
+static gboolean _meter_on_button_release(GtkWidget * widget,
+		GdkEventButton * event, gpointer data);
+#if GTK_CHECK_VERSION(3, 0, 0)
+static gboolean _meter_on_draw(GtkWidget * widget, cairo_t * cr,
+		gpointer data);
+#else
+static gboolean _meter_on_expose(GtkWidget * widget, GdkEventExpose * event,
+		gpointer data);
+#endif
+static gboolean _meter_on_key_press(GtkWidget * widget, GdkEventKey * event,
+		gpointer data);
+static gboolean _meter_on_motion_notify(GtkWidget * widget,
+		GdkEventMotion * event, gpointer data);
+static gboolean _meter_on_scroll(GtkWidget * widget, GdkEventScroll * event,
+		gpointer data);
+
+
+/* public */
+/* variables */
+#ifdef MIXER_BUILTIN
+MixerControlDefinition2 control_meter2 =
+#else
+MixerControlDefinition2 control2 =
+#endif
+{
+	MIXERCONTROL_VERSION,
+	{
+		NULL,
+		"Meter",
+		NULL,
+		_meter_init,
+		_meter_destroy,
+		_meter_get,
+		_meter_get_type,
+		_meter_get_widget,
+		_meter_set
+	},
+	_meter_get_property,
+	_meter_set_property,
+	_meter_get_levels,
+	_meter_set_levels
+};
+
+
+/* private */
+/* functions */
+/* meter_init */
+static MixerControlPlugin * _meter_init(MixerControlPluginHelper * helper,
+		String const * type, va_list properties)
+{
+	MixerControlPlugin * meter;
+	(void) type;
+
+	if((meter = object_new(sizeof(*meter))) == NULL)
+		return NULL;
+	meter->helper = helper;
+	meter->widget = gtk_drawing_area_new();
+	gtk_widget_set_can_focus(meter->widget, TRUE);
+	gtk_widget_add_events(meter->widget, GDK_BUTTON_PRESS_MASK
+			| GDK_BUTTON_RELEASE_MASK | GDK_BUTTON1_MOTION_MASK
+			| GDK_KEY_PRESS_MASK | GDK_SCROLL_MASK);
+	g_signal_connect(meter->widget, "button-press-event", G_CALLBACK(
+				_meter_on_button_press), meter);
+	g_signal_connect(meter->widget, "button-release-event", G_CALLBACK(
+				_meter_on_button_release), meter);
+#if GTK_CHECK_VERSION(3, 0, 0)
+	g_signal_connect(meter->widget, "draw", G_CALLBACK(_meter_on_draw),
+			meter);
+#else
+	g_signal_connect(meter->widget, "expose-event", G_CALLBACK(
+				_meter_on_expose), meter);
+#endif
+	g_signal_connect(meter->widget, "key-press-event", G_CALLBACK(
+				_meter_on_key_press), meter);
+	g_signal_connect(meter->widget, "motion-notify-event", G_CALLBACK(
+				_meter_on_motion_notify), meter);
+	g_signal_connect(meter->widget, "scroll-event", G_CALLBACK(
+				_meter_on_scroll), meter);
+	meter->delta = 1;
+	meter->levels = NULL;
+	meter->levels_cnt = 0;
+	meter->bind = TRUE;
+	meter->mute = FALSE;
+	meter->show_mute = FALSE;
+	meter->drag = -1;
+	meter->channel = 0;
+	_meter_resize(meter);
+	if(_meter_set(meter, properties) != 0)
+	{
+		_meter_destroy(meter);
+		return NULL;
+	}
+	return meter;
+}
+
+
+/* meter_destroy */
+static void _meter_destroy(MixerControlPlugin * meter)
+{
+	free(meter->levels);
+	object_delete(meter);
+}
+
+
+/* accessors */
+/* meter_get */
+static int _meter_get(MixerControlPlugin * meter, va_list properties)
+{
+	String const * p;
+	gboolean * b;
+	double * value;
+	unsigned int * u;
+	size_t i;
+
+	while((p = va_arg(properties, String const *)) != NULL)
+		if(string_compare(p, "bind") == 0)
+		{
+			b = va_arg(properties, gboolean *);
+			*b = meter->bind;
+		}
+		else if(string_compare(p, "delta") == 0)
+		{
+			u = va_arg(properties, unsigned int *);
+			*u = meter->delta;
+		}
+		else if(string_compare(p, "mute") == 0)
+		{
+			b = va_arg(properties, gboolean *);
+			*b = meter->mute;
+		}
+		else if(string_compare(p, "value") == 0)
+		{
+			if(meter->levels_cnt == 0 || meter->bind == FALSE)
+				return -1;
+			value = va_arg(properties, double *);
+			*value = meter->levels[0];
+		}
+		else if(sscanf(p, "value%zu", &i) == 1)
+		{
+			if(i >= meter->levels_cnt)
+				return -1;
+			value = va_arg(properties, double *);
+			*value = meter->levels[i];
+		}
+		else
+			return -1;
+	return 0;
+}
+
+
+/* meter_get_levels */
+static int _meter_get_levels(MixerControlPlugin * meter, uint8_t * levels,
+		size_t levels_cnt)
+{
+	if(levels_cnt > meter->levels_cnt)
+		return -1;
+	memcpy(levels, meter->levels, levels_cnt);
+	return 0;
+}
+
+
+/* meter_get_property */
+static int _meter_get_property(MixerControlPlugin * meter,
+		MixerControlProperty property, unsigned int * value)
+{
+	switch(property)
+	{
+		case MCP_BIND:
+			*value = meter->bind;
+			return 0;
+		case MCP_CHANNELS:
+			*value = meter->levels_cnt;
+			return 0;
+		case MCP_DELTA:
+			*value = meter->delta;
+			return 0;
+		case MCP_MUTE:
+			*value = meter->mute;
+			return 0;
+		default:
+			return -1;
+	}
+}
+
+
+/* meter_get_type */
+static String const * _meter_get_type(MixerControlPlugin * meter)
+{
+	(void) meter;
+
+	return "meter";
+}
+
+
+/* meter_get_widget */
+static GtkWidget * _meter_get_widget(MixerControlPlugin * meter)
+{
+	return meter->widget;
+}
+
+
+/* meter_set */
+static int _meter_set(MixerControlPlugin * meter, va_list properties)
+{
+	String const * p;
+	gboolean b;
+	unsigned int u;
+	gdouble value;
+	size_t zu;
+
+	while((p = va_arg(properties, String const *)) != NULL)
+	{
+		if(string_compare(p, "bind") == 0)
+		{
+			b = va_arg(properties, gboolean);
+			_meter_set_property(meter, MCP_BIND, b);
+		}
+		else if(string_compare(p, "channels") == 0)
+		{
+			zu = va_arg(properties, size_t);
+			if(_meter_set_property(meter, MCP_CHANNELS, zu) != 0)
+				return -1;
+		}
+		else if(string_compare(p, "delta") == 0)
+		{
+			u = va_arg(properties, unsigned int);
+			_meter_set_property(meter, MCP_DELTA, u);
+		}
+		else if(string_compare(p, "mute") == 0)
+		{
+			b = va_arg(properties, gboolean);
+			_meter_set_property(meter, MCP_MUTE, b);
+		}
+		else if(string_compare(p, "show-bind") == 0)
+			/* the channels are unbound with the third button */
+			(void) va_arg(properties, gboolean);
+		else if(string_compare(p, "show-mute") == 0)
+		{
+			b = va_arg(properties, gboolean);
+			_meter_set_property(meter, MCP_SHOW_MUTE, b);
+		}
+		else if(string_compare(p, "value") == 0)
+		{
+			value = va_arg(properties, gdouble);
+			for(zu = 0; zu < meter->levels_cnt; zu++)
+				meter->levels[zu] = CLAMP(value, 0.0, 100.0)
+					+ 0.5;
+			gtk_widget_queue_draw(meter->widget);
+		}
+		else if(sscanf(p, "value%zu", &zu) == 1)
+		{
+			value = va_arg(properties, gdouble);
+			if(zu >= meter->levels_cnt)
+				return -1;
+			meter->levels[zu] = CLAMP(value, 0.0, 100.0) + 0.5;
+			gtk_widget_queue_draw(meter->widget);
+		}
+		else if(string_compare(p, "vgroup") == 0)
+			/* the meters have a fixed height already */
+			(void) va_arg(properties, GtkSizeGroup *);
+		else
+			return -1;
+	}
+	return 0;
+}
+
+
+/* meter_set_levels */
+static int _meter_set_levels(MixerControlPlugin * meter,
+		uint8_t const * levels, size_t levels_cnt)
+{
+	if(levels_cnt > meter->levels_cnt)
+		return -1;
+	if(memcmp(meter->levels, levels, levels_cnt) == 0)
+		return 0;
+	memcpy(meter->levels, levels, levels_cnt);
+	gtk_widget_queue_draw(meter->widget);
+	return 0;
+}
+
+
+/* meter_set_property */
+static int _meter_set_property(MixerControlPlugin * meter,
+		MixerControlProperty property, unsigned int value)
+{
+	uint8_t * p;
+
+	switch(property)
+	{
+		case MCP_BIND:
+			meter->bind = value ? TRUE : FALSE;
+			gtk_widget_queue_draw(meter->widget);
+			return 0;
+		case MCP_CHANNELS:
+			if(value == meter->levels_cnt)
+				return 0;
+			if((p = realloc(meter->levels, value)) == NULL
+					&& value > 0)
+				return -1;
+			if(value > meter->levels_cnt)
+				memset(&p[meter->levels_cnt], 0, value
+						- meter->levels_cnt);
+			meter->levels = p;
+			meter->levels_cnt = value;
+			meter->drag = -1;
+			meter->channel = 0;
+			_meter_resize(meter);
+			return 0;
+		case MCP_DELTA:
+			meter->delta = (value > 0) ? value : 1;
+			return 0;
+		case MCP_MUTE:
+			meter->mute = value ? TRUE : FALSE;
+			gtk_widget_queue_draw(meter->widget);
+			return 0;
+		case MCP_SHOW_BIND:
+			return 0;
+		case MCP_SHOW_MUTE:
+			meter->show_mute = value ? TRUE : FALSE;
+			_meter_resize(meter);
+			return 0;
+		default:
+			return -1;
+	}
+}
+
+
+/* useful */
+/* meter_area */
+static void _meter_area(MixerControlPlugin * meter, int * x, int * top,
+		int * bottom)
+{
+	GtkAllocation allocation;
+	int width;
+
+	gtk_widget_get_allocation(meter->widget, &allocation);
+	/* the bars are centered horizontally */
+	width = meter->levels_cnt * (METER_BAR_WIDTH + METER_SPACING)
+		+ METER_SPACING;
+	*x = MAX(allocation.width - width, 0) / 2 + METER_SPACING;
+	*top = METER_SPACING;
+	*bottom = allocation.height - METER_SPACING;
+	if(meter->show_mute)
+		*bottom -= METER_MUTE_HEIGHT + METER_SPACING;
+	if(*bottom <= *top)
+		*bottom = *top + 1;
+}
+
+
+/* meter_change */
+static void _meter_change(MixerControlPlugin * meter, int channel, int level)
+{
+	size_t i;
+	gboolean changed = FALSE;
+
+	level = CLAMP(level, 0, 100);
+	for(i = 0; i < meter->levels_cnt; i++)
+		if((meter->bind || (int)i == channel)
+				&& meter->levels[i] != level)
+		{
+			meter->levels[i] = level;
+			changed = TRUE;
+		}
+	if(changed == FALSE)
+		return;
+	gtk_widget_queue_draw(meter->widget);
+	meter->helper->mixercontrol_set(meter->helper->control);
+}
+
+
+/* meter_channel */
+static int _meter_channel(MixerControlPlugin * meter, double x)
+{
+	int left;
+	int top;
+	int bottom;
+	int channel;
+
+	if(meter->levels_cnt == 0)
+		return -1;
+	_meter_area(meter, &left, &top, &bottom);
+	/* the spacing belongs to the closest bar */
+	channel = (x - left + METER_SPACING / 2)
+		/ (METER_BAR_WIDTH + METER_SPACING);
+	return CLAMP(channel, 0, (int)meter->levels_cnt - 1);
+}
+
+
+/* meter_draw */
+static void _meter_draw(MixerControlPlugin * meter, cairo_t * cr, double red,
+		double green, double blue, double alpha)
+{
+	int left;
+	int top;
+	int bottom;
+	int height;
+	int width;
+	int x;
+	size_t i;
+	PangoLayout * layout;
+
+	_meter_area(meter, &left, &top, &bottom);
+	height = bottom - top;
+	width = meter->levels_cnt * (METER_BAR_WIDTH + METER_SPACING)
+		- METER_SPACING;
+	/* every channel is drawn as a bar, over its trough */
+	for(i = 0, x = left; i < meter->levels_cnt; i++,
+			x += METER_BAR_WIDTH + METER_SPACING)
+	{
+		cairo_set_source_rgba(cr, red, green, blue, alpha * 0.2);
+		cairo_rectangle(cr, x, top, METER_BAR_WIDTH, height);
+		cairo_fill(cr);
+		cairo_set_source_rgba(cr, red, green, blue, alpha
+				* (meter->mute ? 0.4 : 0.8));
+		cairo_rectangle(cr, x, bottom - (height * meter->levels[i])
+				/ 100, METER_BAR_WIDTH,
+				(height * meter->levels[i]) / 100);
+		cairo_fill(cr);
+	}
+	/* the bound channels are linked above their bars */
+	if(meter->levels_cnt > 1)
+	{
+		cairo_set_source_rgba(cr, red, green, blue, alpha * 0.8);
+		if(meter->bind)
+			cairo_rectangle(cr, left, top / 2 - 1, width, 2);
+		else
+			for(i = 0, x = left; i < meter->levels_cnt; i++,
+					x += METER_BAR_WIDTH + METER_SPACING)
+				cairo_rectangle(cr, x, top / 2 - 1,
+						METER_BAR_WIDTH, 2);
+		cairo_fill(cr);
+	}
+	/* the channels adjusted with the keyboard are underlined */
+	if(gtk_widget_has_focus(meter->widget) && meter->levels_cnt > 0)
+	{
+		cairo_set_source_rgba(cr, red, green, blue, alpha * 0.8);
+		if(meter->bind)
+			cairo_rectangle(cr, left, bottom + 1, width, 2);
+		else
+			cairo_rectangle(cr, left + meter->channel
+					* (METER_BAR_WIDTH + METER_SPACING),
+					bottom + 1, METER_BAR_WIDTH, 2);
+		cairo_fill(cr);
+	}
+	if(meter->show_mute == FALSE)
+		return;
+	cairo_set_source_rgba(cr, red, green, blue, alpha
+			* (meter->mute ? 0.8 : 0.2));
+	cairo_rectangle(cr, left, bottom + METER_SPACING, width,
+			METER_MUTE_HEIGHT);
+	cairo_fill(cr);
+	layout = gtk_widget_create_pango_layout(meter->widget, _("Mute"));
+	pango_layout_get_pixel_size(layout, &x, &height);
+	cairo_set_source_rgba(cr, red, green, blue, alpha
+			* (meter->mute ? 0.2 : 1.0));
+	cairo_move_to(cr, left + (width - x) / 2, bottom + METER_SPACING
+			+ (METER_MUTE_HEIGHT - height) / 2);
+	pango_cairo_show_layout(cr, layout);
+	g_object_unref(layout);
+}
+
+
+/* meter_level */
+static int _meter_level(MixerControlPlugin * meter, double y)
+{
+	int left;
+	int top;
+	int bottom;
+
+	_meter_area(meter, &left, &top, &bottom);
+	return ((bottom - y) * 100 + (bottom - top) / 2) / (bottom - top);
+}
+
+
+/* meter_mute */
+static void _meter_mute(MixerControlPlugin * meter)
+{
+	meter->mute = !meter->mute;
+	gtk_widget_queue_draw(meter->widget);
+	meter->helper->mixercontrol_set(meter->helper->control);
+}
+
+
+/* meter_resize */
+static void _meter_resize(MixerControlPlugin * meter)
+{
+	int width;
+	int height;
+
+	width = MAX(meter->levels_cnt, 1) * (METER_BAR_WIDTH + METER_SPACING)
+		+ METER_SPACING;
+	height = METER_HEIGHT;
+	if(meter->show_mute)
+		height += METER_MUTE_HEIGHT + METER_SPACING;
+	gtk_widget_set_size_request(meter->widget, width, height);
+}
+
+
+/* callbacks */
+/* meter_on_button_press */
+static gboolean _meter_on_button_press(GtkWidget * widget,
+		GdkEventButton * event, gpointer data)
+{
+	MixerControlPlugin * meter = data;
+	int left;
+	int top;
+	int bottom;
+	(void) widget;
+
+	if(event->type != GDK_BUTTON_PRESS)
+		return FALSE;
+	/* the third button binds or unbinds the channels */
+	if(event->button == 3)
+	{
+		meter->bind = !meter->bind;
+		gtk_widget_queue_draw(meter->widget);
+		return TRUE;
+	}
+	if(event->button != 1 || meter->levels_cnt == 0)
+		return FALSE;
+	gtk_widget_grab_focus(meter->widget);
+	_meter_area(meter, &left, &top, &bottom);
+	if(meter->show_mute && event->y > bottom + METER_SPACING / 2)
+	{
+		_meter_mute(meter);
+		return TRUE;
+	}
+	meter->drag = _meter_channel(meter, event->x);
+	meter->channel = meter->drag;
+	_meter_change(meter, meter->drag, _meter_level(meter, event->y));
+	return TRUE;
+}
+
+
+/* meter_on_button_release */
+static gboolean _meter_on_button_release(GtkWidget * widget,
+		GdkEventButton * event, gpointer data)
+{
+	MixerControlPlugin * meter = data;
+	(void) widget;
+
+	if(event->button != 1)
+		return FALSE;
+	meter->drag = -1;
+	return TRUE;
+}
+
+
+#if GTK_CHECK_VERSION(3, 0, 0)
+/* meter_on_draw */
+static gboolean _meter_on_draw(GtkWidget * widget, cairo_t * cr,
+		gpointer data)
+{
+	MixerControlPlugin * meter = data;
+	GdkRGBA color;
+
+	gtk_style_context_get_color(gtk_widget_get_style_context(widget),
+			gtk_widget_get_state_flags(widget), &color);
+	_meter_draw(meter, cr, color.red, color.green, color.blue,
+			color.alpha);
+	return TRUE;
+}
+#else
+/* meter_on_expose */
+static gboolean _meter_on_expose(GtkWidget * widget, GdkEventExpose * event,
+		gpointer data)
+{
+	MixerControlPlugin * meter = data;
+	cairo_t * cr;
+	GdkColor * color;
+	(void) event;
+
+	cr = gdk_cairo_create(gtk_widget_get_window(widget));
+	color = &gtk_widget_get_style(widget)->fg[gtk_widget_get_state(
+			widget)];
+	_meter_draw(meter, cr, color->red / 65535.0, color->green / 65535.0,
+			color->blue / 65535.0, 1.0);
+	cairo_destroy(cr);
+	return TRUE;
+}
+#endif
+
+
+/* meter_on_key_press */
+static gboolean _meter_on_key_press(GtkWidget * widget, GdkEventKey * event,
+		gpointer data)
+{
+	MixerControlPlugin * meter = data;
+	int step;
+	(void) widget;
+
+	if(meter->levels_cnt == 0)
+		return FALSE;
+	switch(event->keyval)
+	{
+		case GDK_KEY_Up:
+		case GDK_KEY_KP_Up:
+			step = meter->delta;
+			break;
+		case GDK_KEY_Down:
+		case GDK_KEY_KP_Down:
+			step = -(int)meter->delta;
+			break;
+		case GDK_KEY_Page_Up:
+		case GDK_KEY_KP_Page_Up:
+			step = MAX(meter->delta, METER_PAGE);
+			break;
+		case GDK_KEY_Page_Down:
+		case GDK_KEY_KP_Page_Down:
+			step = -(int)MAX(meter->delta, METER_PAGE);
+			break;
+		case GDK_KEY_Left:
+		case GDK_KEY_KP_Left:
+			/* the focus leaves past the first channel */
+			if(meter->bind || meter->channel == 0)
+				return FALSE;
+			meter->channel--;
+			gtk_widget_queue_draw(meter->widget);
+			return TRUE;
+		case GDK_KEY_Right:
+		case GDK_KEY_KP_Right:
+			if(meter->bind || meter->channel + 1
+					>= (int)meter->levels_cnt)
+				return FALSE;
+			meter->channel++;
+			gtk_widget_queue_draw(meter->widget);
+			return TRUE;
+		case GDK_KEY_m:
+		case GDK_KEY_M:
+			if(meter->show_mute == FALSE)
+				return FALSE;
+			_meter_mute(meter);
+			return TRUE;
+		default:
+			return FALSE;
+	}
+	_meter_change(meter, meter->channel, meter->levels[meter->channel]
+			+ step);
+	return TRUE;
+}
+
+
+/* meter_on_motion_notify */
+static gboolean _meter_on_motion_notify(GtkWidget * widget,
+		GdkEventMotion * event, gpointer data)
+{
+	MixerControlPlugin * meter = data;
+	(void) widget;
+
+	if(meter->drag < 0)
+		return FALSE;
+	_meter_change(meter, meter->drag, _meter_level(meter, event->y));
+	return TRUE;
+}
+
+
+/* meter_on_scroll */
+static gboolean _meter_on_scroll(GtkWidget * widget, GdkEventScroll * event,
+		gpointer data)
+{
+	MixerControlPlugin * meter = data;
+	int channel;
+	(void) widget;
+
+	if((channel = _meter_channel(meter, event->x)) < 0)
+		return FALSE;
+	switch(event->direction)
+	{
+		case GDK_SCROLL_UP:
+			_meter_change(meter, channel, meter->levels[channel]
+					+ meter->delta);
+			return TRUE;
+		case GDK_SCROLL_DOWN:
+			_meter_change(meter, channel, meter->levels[channel]
+					- meter->delta);
+			return TRUE;
+		default:
+			return FALSE;
+	}
+}
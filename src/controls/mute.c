@@ -74,7 +74,11 @@ static void _mute_on_toggled(gpointer data);
 
 /* public */
 /* variables */
+#ifdef MIXER_BUILTIN
+MixerControlDefinition control_mute =
+#else
 MixerControlDefinition control =
+#endif
 {
 	NULL,
 	"Mute button",
@@ -77,7 +77,11 @@ static void _radio_on_toggled(gpointer data);
 
 /* public */
 /* variables */
+#ifdef MIXER_BUILTIN
+MixerControlDefinition control_radio =
+#else
 MixerControlDefinition control =
+#endif
 {
 	NULL,
 	"Radio buttons",
@@ -76,7 +76,11 @@ static void _set_on_toggled(gpointer data);
 
 /* public */
 /* variables */
+#ifdef MIXER_BUILTIN
+MixerControlDefinition control_set =
+#else
 MixerControlDefinition control =
+#endif
 {
 	NULL,
 	"Set of values",
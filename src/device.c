@@ -0,0 +1,597 @@
+/* $Id$ */
+/* Copyright (c) 2020 Pierre Pronchery <khorben@defora.org> */
+/* This file is part of DeforaOS Desktop Mixer */
+/* All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include "backend.h"
+#include "trace.h"
+#include "device.h"
+
+
+/* MixerDevice */
+/* private */
+/* types */
+typedef enum _MixerDeviceCall
+{
+	MDC_OPEN = 0,
+	MDC_INFO,
+	MDC_MODIFIED,
+	MDC_CHANGED,
+	MDC_PROPERTIES,
+	MDC_READ,
+	MDC_WRITE
+} MixerDeviceCall;
+#define MDC_LAST MDC_WRITE
+#define MDC_COUNT (MDC_LAST + 1)
+
+/* the buckets are powers of two of microseconds */
+#define MIXERDEVICE_BUCKETS 24
+
+typedef struct _MixerDeviceHistogram
+{
+	unsigned long count;
+	unsigned long errors;
+	uint64_t total;
+	uint64_t max;
+	unsigned long buckets[MIXERDEVICE_BUCKETS];
+} MixerDeviceHistogram;
+
+struct _MixerDevice
+{
+	MixerBackendDefinition const * definition;
+	MixerBackend * backend;
+
+	/* the statistics may be read while another thread calls the backend */
+	pthread_mutex_t lock;
+	unsigned long ioctls;
+
+	/* profiling, if enabled */
+	MixerDeviceHistogram * calls;
+	/* reads and writes per control */
+	MixerDeviceHistogram * controls;
+	size_t controls_cnt;
+
+	/* recording, if enabled */
+	FILE * trace;
+};
+
+
+/* prototypes */
+static uint64_t _mixerdevice_clock(void);
+static void _mixerdevice_record(MixerDevice * device, MixerDeviceCall call,
+		size_t position, uint64_t start, int ret, void const * data);
+
+
+/* variables */
+/* the first backend is the default */
+static MixerBackendDefinition const * _mixerdevice_backends[] =
+{
+#if defined(__NetBSD__)
+	&mixerbackend_netbsd,
+#else
+	&mixerbackend_oss,
+	&mixerbackend_oss4,
+#endif
+	&mixerbackend_sim,
+	&mixerbackend_trace
+};
+
+static String const * _mixerdevice_calls[MDC_COUNT] =
+{
+	"open", "info", "modified", "changed", "properties", "read", "write"
+};
+
+static int _mixerdevice_profile = 0;
+static String const * _mixerdevice_trace = NULL;
+
+
+/* public */
+/* variables */
+#define _L(l)	MIXERBACKEND_LEVEL_PERCENT(l)
+#define _L4(l)	_L(l), _L(l + 1), _L(l + 2), _L(l + 3)
+#define _L16(l)	_L4(l), _L4(l + 4), _L4(l + 8), _L4(l + 12)
+#define _L64(l)	_L16(l), _L16(l + 16), _L16(l + 32), _L16(l + 48)
+uint8_t const mixerbackend_level_percent[256] =
+{
+	_L64(0), _L64(64), _L64(128), _L64(192)
+};
+#undef _L64
+#undef _L16
+#undef _L4
+#undef _L
+
+#define _P(p)	MIXERBACKEND_PERCENT_LEVEL(p)
+#define _P4(p)	_P(p), _P(p + 1), _P(p + 2), _P(p + 3)
+#define _P16(p)	_P4(p), _P4(p + 4), _P4(p + 8), _P4(p + 12)
+uint8_t const mixerbackend_percent_level[101] =
+{
+	_P16(0), _P16(16), _P16(32), _P16(48), _P16(64), _P16(80), _P4(96),
+	_P(100)
+};
+#undef _P16
+#undef _P4
+#undef _P
+
+
+/* functions */
+/* mixerdevice_new */
+static int _new_trace(MixerDevice * device);
+
+MixerDevice * mixerdevice_new(String const * name)
+{
+	MixerDevice * device;
+	MixerBackendDefinition const * definition;
+	String const * p;
+	size_t i;
+	size_t len;
+	uint64_t start;
+
+	/* the backend may be selected as in "sim:controls=1000" */
+	definition = _mixerdevice_backends[0];
+	p = name;
+	for(i = 0; i < sizeof(_mixerdevice_backends)
+			/ sizeof(*_mixerdevice_backends); i++)
+	{
+		len = string_get_length(_mixerdevice_backends[i]->name);
+		if(string_compare_length(name, _mixerdevice_backends[i]->name,
+					len) == 0 && name[len] == ':')
+		{
+			definition = _mixerdevice_backends[i];
+			p = &name[len + 1];
+			break;
+		}
+	}
+	if((device = malloc(sizeof(*device))) == NULL)
+		return NULL;
+	device->definition = definition;
+	device->calls = NULL;
+	device->controls = NULL;
+	device->controls_cnt = 0;
+	device->trace = NULL;
+	start = _mixerdevice_clock();
+	if(pthread_mutex_init(&device->lock, NULL) != 0)
+	{
+		free(device);
+		return NULL;
+	}
+	if((device->backend = definition->init(p)) == NULL)
+	{
+		pthread_mutex_destroy(&device->lock);
+		free(device);
+		return NULL;
+	}
+	device->ioctls = definition->get_ioctls(device->backend);
+	if(_mixerdevice_profile)
+	{
+		device->controls_cnt = definition->get_count(device->backend);
+		if((device->calls = calloc(MDC_COUNT, sizeof(*device->calls)))
+				== NULL
+				|| (device->controls = calloc(
+						device->controls_cnt * 2,
+						sizeof(*device->controls)))
+				== NULL)
+		{
+			mixerdevice_delete(device);
+			return NULL;
+		}
+		_mixerdevice_record(device, MDC_OPEN, 0, start, 0, NULL);
+	}
+	if(_mixerdevice_trace != NULL && _new_trace(device) != 0)
+	{
+		mixerdevice_delete(device);
+		return NULL;
+	}
+	return device;
+}
+
+static int _new_trace(MixerDevice * device)
+{
+	MixerTraceRecord record;
+	MixerDeviceInfo const * info;
+	size_t cnt;
+	size_t i;
+
+	if((device->trace = fopen(_mixerdevice_trace, "wb")) == NULL
+			|| mixertrace_write_header(device->trace) != 0)
+		return -1;
+	/* the controls are recorded once */
+	record.type = MTT_INFO;
+	record.ret = 0;
+	record.duration = 0;
+	record.level = 0;
+	cnt = device->definition->get_count(device->backend);
+	for(i = 0; i < cnt; i++)
+	{
+		if((info = device->definition->get_info(device->backend, i))
+				== NULL)
+			continue;
+		record.position = i;
+		if(mixertrace_write_record(device->trace, &record,
+					(MixerTraceData const *)info) != 0)
+			return -1;
+	}
+	return 0;
+}
+
+
+/* mixerdevice_delete */
+void mixerdevice_delete(MixerDevice * device)
+{
+	int error = errno;
+
+	device->definition->destroy(device->backend);
+	pthread_mutex_destroy(&device->lock);
+	if(device->trace != NULL)
+		fclose(device->trace);
+	free(device->calls);
+	free(device->controls);
+	free(device);
+	errno = error;
+}
+
+
+/* accessors */
+/* mixerdevice_get_changed */
+int mixerdevice_get_changed(MixerDevice * device, size_t position)
+{
+	int ret;
+	uint64_t start;
+
+	/* assume a change if the backend cannot tell */
+	if(device->definition->get_changed == NULL)
+		return 1;
+	start = _mixerdevice_clock();
+	ret = device->definition->get_changed(device->backend, position);
+	/* the flag is recorded as returned */
+	_mixerdevice_record(device, MDC_CHANGED, position, start, ret, NULL);
+	return ret;
+}
+
+
+/* mixerdevice_get_count */
+size_t mixerdevice_get_count(MixerDevice * device)
+{
+	return device->definition->get_count(device->backend);
+}
+
+
+/* mixerdevice_get_info */
+MixerDeviceInfo const * mixerdevice_get_info(MixerDevice * device,
+		size_t position)
+{
+	MixerDeviceInfo const * ret;
+	uint64_t start;
+
+	if(device->calls == NULL)
+		/* the controls are recorded when opening */
+		return device->definition->get_info(device->backend, position);
+	start = _mixerdevice_clock();
+	ret = device->definition->get_info(device->backend, position);
+	_mixerdevice_record(device, MDC_INFO, position, start,
+			(ret != NULL) ? 0 : -1, NULL);
+	return ret;
+}
+
+
+/* mixerdevice_get_ioctls */
+unsigned long mixerdevice_get_ioctls(MixerDevice * device)
+{
+	unsigned long ret;
+
+	/* as published after the last call */
+	pthread_mutex_lock(&device->lock);
+	ret = device->ioctls;
+	pthread_mutex_unlock(&device->lock);
+	return ret;
+}
+
+
+/* mixerdevice_get_modified */
+int mixerdevice_get_modified(MixerDevice * device)
+{
+	int ret;
+	uint64_t start;
+
+	start = _mixerdevice_clock();
+	ret = device->definition->get_modified(device->backend);
+	/* the flag is recorded as returned */
+	_mixerdevice_record(device, MDC_MODIFIED, 0, start, ret, NULL);
+	return ret;
+}
+
+
+/* mixerdevice_get_properties */
+int mixerdevice_get_properties(MixerDevice * device,
+		MixerProperties * properties, char const ** error)
+{
+	int ret;
+	uint64_t start;
+
+	start = _mixerdevice_clock();
+	ret = device->definition->get_properties(device->backend, properties,
+			error);
+	_mixerdevice_record(device, MDC_PROPERTIES, 0, start, ret, properties);
+	return ret;
+}
+
+
+/* mixerdevice_get_value */
+int mixerdevice_get_value(MixerDevice * device, size_t position,
+		MixerValue * value, char const ** error)
+{
+	int ret;
+	uint64_t start;
+
+	start = _mixerdevice_clock();
+	ret = device->definition->get_value(device->backend, position, value,
+			error);
+	_mixerdevice_record(device, MDC_READ, position, start, ret, value);
+	return ret;
+}
+
+
+/* mixerdevice_set_value */
+int mixerdevice_set_value(MixerDevice * device, size_t position,
+		MixerValue const * value, char const ** error)
+{
+	int ret;
+	uint64_t start;
+
+	start = _mixerdevice_clock();
+	ret = device->definition->set_value(device->backend, position, value,
+			error);
+	_mixerdevice_record(device, MDC_WRITE, position, start, ret, value);
+	return ret;
+}
+
+
+/* mixerdevice_set_profile */
+void mixerdevice_set_profile(int profile)
+{
+	_mixerdevice_profile = profile;
+}
+
+
+/* mixerdevice_set_trace */
+void mixerdevice_set_trace(String const * filename)
+{
+	_mixerdevice_trace = filename;
+}
+
+
+/* useful */
+/* mixerdevice_lookup */
+int mixerdevice_lookup(MixerDevice * device, String const * name,
+		size_t * position)
+{
+	size_t cnt;
+	size_t i;
+	MixerDeviceInfo const * info;
+	String const * p;
+	size_t len;
+
+	/* the name may be qualified with the class, as in "outputs.master" */
+	cnt = mixerdevice_get_count(device);
+	for(i = 0; i < cnt; i++)
+	{
+		info = mixerdevice_get_info(device, i);
+		if(info->type == MDT_CLASS)
+			continue;
+		if(string_compare(info->name, name) == 0)
+			break;
+		if(info->mixer_class < 0)
+			continue;
+		p = mixerdevice_get_info(device, info->mixer_class)->name;
+		len = string_get_length(p);
+		if(string_compare_length(p, name, len) == 0 && name[len] == '.'
+				&& string_compare(info->name, &name[len + 1])
+				== 0)
+			break;
+	}
+	if(i == cnt)
+	{
+		errno = ENOENT;
+		return -1;
+	}
+	*position = i;
+	return 0;
+}
+
+
+/* mixerdevice_print_stats */
+static void _print_stats_histogram(FILE * fp, String const * name,
+		String const * call, MixerDeviceHistogram const * histogram);
+
+void mixerdevice_print_stats(MixerDevice * device, FILE * fp)
+{
+	size_t i;
+	MixerDeviceInfo const * info;
+	MixerDeviceHistogram histograms[2];
+
+	if(device->calls == NULL)
+		return;
+	for(i = 0; i < MDC_COUNT; i++)
+	{
+		/* printed from a copy, as the calls go on meanwhile */
+		pthread_mutex_lock(&device->lock);
+		histograms[0] = device->calls[i];
+		pthread_mutex_unlock(&device->lock);
+		_print_stats_histogram(fp, NULL, _mixerdevice_calls[i],
+				&histograms[0]);
+	}
+	for(i = 0; i < device->controls_cnt; i++)
+	{
+		/* not accounted for */
+		info = device->definition->get_info(device->backend, i);
+		pthread_mutex_lock(&device->lock);
+		histograms[0] = device->controls[i * 2];
+		histograms[1] = device->controls[i * 2 + 1];
+		pthread_mutex_unlock(&device->lock);
+		_print_stats_histogram(fp, (info != NULL) ? info->name : "",
+				_mixerdevice_calls[MDC_READ], &histograms[0]);
+		_print_stats_histogram(fp, (info != NULL) ? info->name : "",
+				_mixerdevice_calls[MDC_WRITE], &histograms[1]);
+	}
+	fflush(fp);
+}
+
+static void _print_stats_histogram(FILE * fp, String const * name,
+		String const * call, MixerDeviceHistogram const * histogram)
+{
+	size_t i;
+
+	if(histogram->count == 0)
+		return;
+	fprintf(fp, "%s%s%s: count=%lu errors=%lu avg=%luus max=%luus",
+			(name != NULL) ? name : "", (name != NULL) ? "." : "",
+			call, histogram->count, histogram->errors,
+			(unsigned long)(histogram->total / histogram->count
+				/ 1000),
+			(unsigned long)(histogram->max / 1000));
+	for(i = 0; i < MIXERDEVICE_BUCKETS; i++)
+		if(histogram->buckets[i] > 0)
+			fprintf(fp, " <%luus=%lu", 1ul << i,
+					histogram->buckets[i]);
+	fputc('\n', fp);
+}
+
+
+/* private */
+/* functions */
+/* mixerdevice_clock */
+static uint64_t _mixerdevice_clock(void)
+{
+	struct timespec ts;
+
+	if((_mixerdevice_profile == 0 && _mixerdevice_trace == NULL)
+			|| clock_gettime(CLOCK_MONOTONIC, &ts) != 0)
+		return 0;
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+/* mixerdevice_record */
+static void _record_histogram(MixerDeviceHistogram * histogram,
+		uint64_t duration, int ret);
+
+static void _record_trace(MixerDevice * device, MixerDeviceCall call,
+		size_t position, uint64_t duration, int ret, void const * data);
+
+static void _mixerdevice_record(MixerDevice * device, MixerDeviceCall call,
+		size_t position, uint64_t start, int ret, void const * data)
+{
+	uint64_t duration;
+
+	duration = _mixerdevice_clock();
+	duration = (duration > start) ? duration - start : 0;
+	if(device->trace != NULL)
+		_record_trace(device, call, position, duration, ret, data);
+	pthread_mutex_lock(&device->lock);
+	/* the descriptions are obtained from any thread, without ioctls */
+	if(call != MDC_INFO)
+		device->ioctls = device->definition->get_ioctls(
+				device->backend);
+	if(device->calls != NULL)
+	{
+		if(call == MDC_MODIFIED || call == MDC_CHANGED)
+			ret = (ret >= 0) ? 0 : -1;
+		_record_histogram(&device->calls[call], duration, ret);
+		if((call == MDC_READ || call == MDC_WRITE)
+				&& position < device->controls_cnt)
+			_record_histogram(&device->controls[position * 2
+					+ ((call == MDC_WRITE) ? 1 : 0)],
+					duration, ret);
+	}
+	pthread_mutex_unlock(&device->lock);
+}
+
+static void _record_histogram(MixerDeviceHistogram * histogram,
+		uint64_t duration, int ret)
+{
+	uint64_t us;
+	size_t i;
+
+	histogram->count++;
+	if(ret != 0)
+		histogram->errors++;
+	histogram->total += duration;
+	if(duration > histogram->max)
+		histogram->max = duration;
+	/* bucket i counts the calls faster than 2^i microseconds */
+	for(us = duration / 1000, i = 0; us > 0 && i < MIXERDEVICE_BUCKETS - 1;
+			us >>= 1)
+		i++;
+	histogram->buckets[i]++;
+}
+
+static void _record_trace(MixerDevice * device, MixerDeviceCall call,
+		size_t position, uint64_t duration, int ret, void const * data)
+{
+	MixerTraceRecord record;
+	MixerDeviceInfo const * info;
+
+	switch(call)
+	{
+		case MDC_CHANGED:
+			record.type = MTT_CHANGED;
+			break;
+		case MDC_MODIFIED:
+			record.type = MTT_MODIFIED;
+			break;
+		case MDC_PROPERTIES:
+			record.type = MTT_PROPERTIES;
+			break;
+		case MDC_READ:
+			record.type = MTT_READ;
+			break;
+		case MDC_WRITE:
+			record.type = MTT_WRITE;
+			break;
+		default:
+			return;
+	}
+	record.position = position;
+	record.ret = ret;
+	record.duration = (duration / 1000 > UINT32_MAX) ? UINT32_MAX
+		: duration / 1000;
+	info = device->definition->get_info(device->backend, position);
+	record.level = (info != NULL && info->type == MDT_VALUE) ? 1 : 0;
+	/* stop recording upon errors */
+	if(mixertrace_write_record(device->trace, &record, data) != 0)
+	{
+		fclose(device->trace);
+		device->trace = NULL;
+	}
+}
@@ -0,0 +1,126 @@
+/* $Id$ */
+/* Copyright (c) 2020 Pierre Pronchery <khorben@defora.org> */
+/* This file is part of DeforaOS Desktop Mixer */
+/* All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+
+#ifndef MIXER_DEVICE_H
+# define MIXER_DEVICE_H
+
+# include <sys/types.h>
+# include <stdint.h>
+# include <stdio.h>
+# include <System/string.h>
+
+
+/* MixerDevice */
+/* types */
+typedef struct _MixerDevice MixerDevice;
+
+typedef enum _MixerDeviceType
+{
+	MDT_CLASS = 0,
+	MDT_ENUM,
+	MDT_SET,
+	MDT_VALUE
+} MixerDeviceType;
+
+typedef struct _MixerDeviceMember
+{
+	char name[32];
+	int value;
+} MixerDeviceMember;
+
+typedef struct _MixerDeviceInfo
+{
+	MixerDeviceType type;
+	/* position of the class, or -1 */
+	int mixer_class;
+	char name[32];
+	/* optional */
+	char label[32];
+
+	/* MDT_ENUM and MDT_SET */
+	MixerDeviceMember members[32];
+	size_t members_cnt;
+
+	/* MDT_VALUE */
+	size_t channels_cnt;
+	uint8_t delta;
+} MixerDeviceInfo;
+
+/* the levels are expressed in percents */
+# define MIXERDEVICE_CHANNELS_MAX	32
+typedef struct _MixerLevel
+{
+	uint8_t channels[MIXERDEVICE_CHANNELS_MAX];
+	uint8_t delta;
+	size_t channels_cnt;
+} MixerLevel;
+
+typedef union _MixerValue
+{
+	int ord;
+	int mask;
+	MixerLevel level;
+} MixerValue;
+
+typedef struct _MixerProperties
+{
+	char name[32];
+	char version[16];
+	char device[16];
+} MixerProperties;
+
+
+/* functions */
+MixerDevice * mixerdevice_new(String const * name);
+void mixerdevice_delete(MixerDevice * device);
+
+/* accessors */
+int mixerdevice_get_changed(MixerDevice * device, size_t position);
+size_t mixerdevice_get_count(MixerDevice * device);
+MixerDeviceInfo const * mixerdevice_get_info(MixerDevice * device,
+		size_t position);
+unsigned long mixerdevice_get_ioctls(MixerDevice * device);
+int mixerdevice_get_modified(MixerDevice * device);
+int mixerdevice_get_properties(MixerDevice * device,
+		MixerProperties * properties, char const ** error);
+int mixerdevice_get_value(MixerDevice * device, size_t position,
+		MixerValue * value, char const ** error);
+
+int mixerdevice_set_value(MixerDevice * device, size_t position,
+		MixerValue const * value, char const ** error);
+void mixerdevice_set_profile(int profile);
+void mixerdevice_set_trace(String const * filename);
+
+/* useful */
+int mixerdevice_lookup(MixerDevice * device, String const * name,
+		size_t * position);
+void mixerdevice_print_stats(MixerDevice * device, FILE * fp);
+
+#endif /* !MIXER_DEVICE_H */
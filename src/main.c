@@ -29,10 +29,19 @@
 
 
 #include <unistd.h>
+#include <signal.h>
+#include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <errno.h>
 #include <locale.h>
 #include <libintl.h>
 #include <gtk/gtk.h>
+#if GLIB_CHECK_VERSION(2, 36, 0)
+# include <glib-unix.h>
+#endif
+#include "device.h"
+#include "query.h"
 #include "window.h"
 #include "../config.h"
 #define _(string) gettext(string)
@@ -54,7 +63,10 @@
 
 
 /* prototypes */
-static int _mixer(char const * device, MixerLayout layout, gboolean embedded);
+static int _mixer(char const * device, MixerLayout layout, gboolean embedded,
+		gboolean stats);
+static int _query(int argc, char * argv[]);
+static int _query_wanted(int argc, char * argv[]);
 
 static int _error(char const * message, int ret);
 static int _usage(void);
@@ -62,17 +74,86 @@ static int _usage(void);
 
 /* functions */
 /* mixer */
-static int _mixer(char const * device, MixerLayout layout, gboolean embedded)
+#if GLIB_CHECK_VERSION(2, 36, 0)
+static gboolean _mixer_on_sigusr1(gpointer data);
+#endif
+
+static int _mixer(char const * device, MixerLayout layout, gboolean embedded,
+		gboolean stats)
 {
 	MixerWindow * mixer;
+#if GLIB_CHECK_VERSION(2, 36, 0)
+	guint source = 0;
+#endif
 
+	mixerdevice_set_profile(stats ? 1 : 0);
 	if((mixer = mixerwindow_new(device, layout, embedded)) == NULL)
 		return 2;
+#if GLIB_CHECK_VERSION(2, 36, 0)
+	/* the statistics can also be dumped while running */
+	if(stats)
+		source = g_unix_signal_add(SIGUSR1, _mixer_on_sigusr1, mixer);
+#endif
 	gtk_main();
+#if GLIB_CHECK_VERSION(2, 36, 0)
+	if(source != 0)
+		g_source_remove(source);
+#endif
+	if(stats)
+		mixerwindow_print_stats(mixer, stderr);
 	mixerwindow_delete(mixer);
 	return 0;
 }
 
+#if GLIB_CHECK_VERSION(2, 36, 0)
+static gboolean _mixer_on_sigusr1(gpointer data)
+{
+	MixerWindow * mixer = data;
+
+	mixerwindow_print_stats(mixer, stderr);
+	return TRUE;
+}
+#endif
+
+
+/* query */
+static int _query(int argc, char * argv[])
+{
+	int ret;
+
+	if((ret = mixerquery(PROGNAME_MIXER, argc, argv)) < 0)
+		return _usage();
+	return ret;
+}
+
+
+/* query_wanted */
+static int _query_wanted(int argc, char * argv[])
+{
+	int i;
+	char const * p;
+
+	/* look for "q" in every cluster of options, as in "-sq master" */
+	for(i = 1; i < argc; i++)
+	{
+		if(argv[i][0] != '-' || argv[i][1] == '\0')
+			continue;
+		if(strcmp(argv[i], "--") == 0)
+			break;
+		for(p = &argv[i][1]; *p != '\0'; p++)
+			if(*p == 'q')
+				return 1;
+			else if(*p == 'd' || *p == 'r')
+			{
+				/* skip the argument of the option */
+				if(p[1] == '\0')
+					i++;
+				break;
+			}
+	}
+	return 0;
+}
+
 
 /* error */
 static int _error(char const * message, int ret)
@@ -86,12 +167,17 @@ static int _error(char const * message, int ret)
 /* usage */
 static int _usage(void)
 {
-	fprintf(stderr, _("Usage: %s [-H|-T|-V][-d device][-x]\n"
+	fprintf(stderr, _("Usage: %s [-H|-T|-V][-d device][-m][-r trace][-s][-x]\n"
+"       %s [-d device][-r trace][-s] -q control[=value]...\n"
 "  -H	Show the classes next to each other\n"
 "  -T	Show the classes in separate tabs\n"
 "  -V	Show the classes on top of each other\n"
 "  -d	The mixer device to use\n"
-"  -x	Enable embedded mode\n"), PROGNAME_MIXER);
+"  -m	Show the levels as meters, with fewer widgets\n"
+"  -q	Get or set the value of a control, without any window\n"
+"  -r	Record the calls to the device into a trace file\n"
+"  -s	Print statistics on the device calls when exiting\n"
+"  -x	Enable embedded mode\n"), PROGNAME_MIXER, PROGNAME_MIXER);
 	return 1;
 }
 
@@ -103,13 +189,22 @@ int main(int argc, char * argv[])
 	char const * device = NULL;
 	MixerLayout layout = ML_TABBED;
 	gboolean embedded = FALSE;
+	gboolean stats = FALSE;
 
 	if(setlocale(LC_ALL, "") == NULL)
 		_error("setlocale", 1);
 	bindtextdomain(PACKAGE, LOCALEDIR);
 	textdomain(PACKAGE);
+	/* the queries do not involve Gtk+ at all */
+	if(_query_wanted(argc, argv))
+		return _query(argc, argv);
+#if !GLIB_CHECK_VERSION(2, 32, 0)
+	/* the mixer accesses the device from a thread */
+	if(!g_thread_supported())
+		g_thread_init(NULL);
+#endif
 	gtk_init(&argc, &argv);
-	while((o = getopt(argc, argv, "HTVd:x")) != -1)
+	while((o = getopt(argc, argv, "HTVd:mr:sx")) != -1)
 		switch(o)
 		{
 			case 'H':
@@ -124,6 +219,15 @@ int main(int argc, char * argv[])
 			case 'd':
 				device = optarg;
 				break;
+			case 'm':
+				mixer_set_meters(TRUE);
+				break;
+			case 'r':
+				mixerdevice_set_trace(optarg);
+				break;
+			case 's':
+				stats = TRUE;
+				break;
 			case 'x':
 				embedded = TRUE;
 				break;
@@ -132,5 +236,5 @@ int main(int argc, char * argv[])
 		}
 	if(optind != argc)
 		return _usage();
-	return (_mixer(device, layout, embedded) == 0) ? 0 : 2;
+	return (_mixer(device, layout, embedded, stats) == 0) ? 0 : 2;
 }
@@ -30,27 +30,20 @@
 
 
 
-#if defined(__NetBSD__)
-# include <sys/ioctl.h>
-# include <sys/audioio.h>
-#else
-# include <sys/ioctl.h>
-# include <sys/soundcard.h>
-#endif
 #include <fcntl.h>
 #include <unistd.h>
-#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <ctype.h>
+#include <time.h>
 #include <errno.h>
-#include <math.h>
 #include <libintl.h>
 #include <gtk/gtk.h>
 #include <Desktop.h>
 #include "control.h"
 #include "common.h"
+#include "device.h"
 #include "mixer.h"
 #include "../config.h"
 #define _(string) gettext(string)
@@ -66,66 +59,200 @@
 #ifndef PROGNAME_MIXER
 # define PROGNAME_MIXER	"mixer"
 #endif
+#define MIXER_REFRESH_FAST	100
+#define MIXER_REFRESH_SLOW	3200
+#define MIXER_WRITE_INTERVAL	16
+#define MIXER_ERROR_INTERVAL	10
+#define MIXER_QUEUE_SIZE	256
+#define MIXER_CLASS_OUTPUTS	"outputs"
 
 
 /* Mixer */
 /* private */
 /* types */
-#ifdef AUDIO_MIXER_DEVINFO
 typedef struct _MixerClass
 {
 	int mixer_class;
-	audio_mixer_name_t label;
+	String const * name;
 	GtkWidget * hbox;
 	int page;
+	/* the controls are only created once the page is shown */
+	gboolean loaded;
 } MixerClass;
-#endif
 
-typedef struct _MixerLevel
+typedef enum _MixerControlKind
 {
-	uint8_t channels[8];
-	uint8_t delta;
-	size_t channels_cnt;
-} MixerLevel;
+	MCK_CHANNELS = 0,
+	MCK_MUTE,
+	MCK_RADIO,
+	MCK_SET
+} MixerControlKind;
+#define MCK_LAST MCK_SET
+#define MCK_COUNT (MCK_LAST + 1)
 
 /* XXX rename this type */
 typedef struct _MixerControl2
 {
-	int index;
-	int type;
-	union {
-		int ord;
-		int mask;
-		MixerLevel level;
-	} un;
+	/* position in the device */
+	size_t index;
+	/* position of the class in mixer->classes */
+	size_t mclass;
+	MixerDeviceType type;
+	MixerControlKind kind;
+	/* MDT_ENUM and MDT_SET */
+	int value;
+	/* MDT_VALUE: position and count in mixer->levels */
+	size_t level;
+	uint8_t channels_cnt;
+	uint8_t delta;
+
+	/* last state known to the widget, levels in mixer->shadows */
+	int shadow;
+	gboolean sensitive;
+	/* not read yet, binding is only detected with the first levels */
+	gboolean fresh;
+
+	/* a read is still to be posted to the thread */
+	gboolean stale;
+	/* a write is pending */
+	gboolean pending;
+	/* the widget is updated with the next frame */
+	gboolean dirty;
+	/* bumped on every write, to discard the reads issued before */
+	unsigned int serial;
 
 	MixerControl * control;
 } MixerControl2;
 
+typedef struct _MixerError
+{
+	String * message;
+	int code;
+	unsigned long count;
+	/* count at the time of the last report */
+	unsigned long reported;
+	time_t time;
+} MixerError;
+
+/* device thread */
+typedef enum _MixerMessageType
+{
+	MMT_READ = 0,
+	MMT_REFRESH,
+	MMT_WRITE
+} MixerMessageType;
+
+typedef struct _MixerMessage
+{
+	MixerMessageType type;
+	size_t position;
+	unsigned int serial;
+	/* position in the device */
+	size_t index;
+	MixerValue value;
+
+	/* result */
+	int ret;
+	char const * error;
+} MixerMessage;
+
+/* single producer, single consumer */
+typedef struct _MixerQueue
+{
+	MixerMessage messages[MIXER_QUEUE_SIZE];
+	gint head;
+	gint tail;
+} MixerQueue;
+
+typedef struct _MixerThread
+{
+	GThread * thread;
+	gint quit;
+
+	/* from the interface to the device */
+	MixerQueue commands;
+	int wake[2];
+
+	/* from the device to the interface */
+	MixerQueue results;
+	int notify[2];
+	gint stalled;
+	GIOChannel * channel;
+	guint source;
+} MixerThread;
+
 struct _Mixer
 {
 	/* widgets */
 	GtkWidget * window;
 	GtkWidget * widget;
 	GtkWidget * notebook;
+	GtkWidget * infobar;
+	GtkWidget * infobar_label;
 	GtkWidget * properties;
 	PangoFontDescription * bold;
+	GtkSizeGroup * hgroup;
+	GtkSizeGroup * vgroup;
 
 	/* internals */
-	String * device;
-#ifdef AUDIO_MIXER_DEVINFO
-	int fd;
+	MixerDevice * device;
+	MixerProperties info;
+	int info_ret;
+	char const * info_error;
 
 	MixerClass * classes;
 	size_t classes_cnt;
-#else
-	int fd;
-#endif
 
 	MixerControl2 * controls;
 	size_t controls_cnt;
 
+	/* levels of every control, as known and as last shown */
+	uint8_t * levels;
+	uint8_t * shadows;
+	size_t levels_cnt;
+
+	/* refresh */
 	guint source;
+	unsigned int refresh_interval;
+	gboolean refresh_changed;
+	/* the interval is adapted once the scheduled refresh completes */
+	gboolean refresh_scheduled;
+	gboolean mapped;
+	gboolean iconified;
+	gboolean obscured;
+
+	/* pending writes */
+	size_t * pending;
+	size_t pending_cnt;
+	guint pending_source;
+	unsigned int write_interval;
+	unsigned long writes;
+	unsigned long writes_coalesced;
+
+	/* widget updates, applied at once with the next frame */
+	size_t * dirty;
+	size_t dirty_cnt;
+	guint frame_source;
+	gint64 dirty_time;
+	unsigned long frames;
+	unsigned long frames_dropped;
+	/* time spent in the main loop, in microseconds */
+	unsigned long ui_time;
+
+	/* errors */
+	MixerError * errors;
+	size_t errors_cnt;
+	unsigned long errors_total;
+
+	/* device thread */
+	MixerThread * thread;
+	unsigned int refreshing;
+	unsigned long refreshes;
+	unsigned long reads;
+	/* first control with a read still to post, if any */
+	size_t refresh_next;
+	/* the refresh completes once its reads are all posted */
+	gboolean refresh_posting;
 };
 
 
@@ -133,89 +260,194 @@ struct _Mixer
 static int _mixer_error(Mixer * mixer, char const * message, int ret);
 
 /* accessors */
-static int _mixer_get_control(Mixer * mixer, MixerControl2 * control);
-static int _mixer_set_control(Mixer * mixer, MixerControl2 * control);
+static gboolean _mixer_get_bind(Mixer * mixer, MixerControl2 * control);
+
+static MixerControl2 * _mixer_get_control2(Mixer * mixer,
+		MixerControl * control);
 
 static int _mixer_set_control_widget(Mixer * mixer, MixerControl2 * control);
 
 static String const * _mixer_get_icon(String const * id);
 
+static void _mixer_get_value(Mixer * mixer, MixerControl2 * control,
+		MixerValue * value);
+static void _mixer_set_value(Mixer * mixer, MixerControl2 * control,
+		MixerValue const * value);
+
+static gboolean _mixer_get_visible(Mixer * mixer, MixerControl2 * control);
+
 /* useful */
+static int _mixer_compare_control(Mixer * mixer, MixerControl2 * control);
+
+static int _mixer_flush(Mixer * mixer);
+
+static int _mixer_invalidate_control(Mixer * mixer, MixerControl2 * control);
+
+static int _mixer_load_class(Mixer * mixer, MixerClass * p);
+
+static void _mixer_notify(int fd);
+
+static int _mixer_post(Mixer * mixer, MixerMessage * message);
+static void _mixer_post_reads(Mixer * mixer);
+
+static int _mixer_queue_full(MixerQueue * queue);
+static int _mixer_queue_pop(MixerQueue * queue, MixerMessage * message);
+static int _mixer_queue_push(MixerQueue * queue, MixerMessage const * message);
+
+static int _mixer_read_control(Mixer * mixer, MixerControl2 * control);
+static void _mixer_read_later(Mixer * mixer, MixerControl2 * control);
+
+static int _mixer_refresh_class(Mixer * mixer, MixerClass * p);
 static int _mixer_refresh_control(Mixer * mixer, MixerControl2 * control);
 
+static void _mixer_refreshed(Mixer * mixer);
+
+static void _mixer_schedule_refresh(Mixer * mixer, unsigned int interval);
+
 static void _mixer_scrolled_window_add(GtkWidget * window, GtkWidget * widget);
 
+static void _mixer_shadow_control(Mixer * mixer, MixerControl2 * control);
+
+static void _mixer_show_hbox(Mixer * mixer, MixerClass * p);
 static void _mixer_show_view(Mixer * mixer, int view);
 
+static int _mixer_start_thread(Mixer * mixer);
+static void _mixer_stop_thread(Mixer * mixer);
+
+static int _mixer_update_control(Mixer * mixer, MixerControl2 * control,
+		int ret, char const * error);
+
+static int _mixer_write_control(Mixer * mixer, MixerControl2 * control);
+
+/* mixer_set */
+static int _set_channels(Mixer * mixer, MixerControl2 * mc);
+static int _set_mute(Mixer * mixer, MixerControl2 * mc);
+static int _set_radio(Mixer * mixer, MixerControl2 * mc);
+static int _set_set(Mixer * mixer, MixerControl2 * mc);
+
+/* mixer_set_control_widget */
+static int _set_control_widget_channels(Mixer * mixer, MixerControl2 * control);
+static int _set_control_widget_mute(Mixer * mixer, MixerControl2 * control);
+static int _set_control_widget_radio(Mixer * mixer, MixerControl2 * control);
+static int _set_control_widget_set(Mixer * mixer, MixerControl2 * control);
+
+
+/* variables */
+static const struct
+{
+	String const * type;
+	int (*set)(Mixer * mixer, MixerControl2 * mc);
+	int (*set_widget)(Mixer * mixer, MixerControl2 * control);
+} _mixer_kinds[MCK_COUNT] =
+{
+	{ "channels",	_set_channels,	_set_control_widget_channels	},
+	{ "mute",	_set_mute,	_set_control_widget_mute	},
+	{ "radio",	_set_radio,	_set_control_widget_radio	},
+	{ "set",	_set_set,	_set_control_widget_set		}
+};
+
+/* the levels can be drawn as meters instead, with a single widget */
+static gboolean _mixer_meters = FALSE;
+
 
 /* public */
 /* mixer_new */
 static GtkWidget * _new_frame_label(GdkPixbuf * pixbuf, char const * name,
 		char const * label);
-#ifdef AUDIO_MIXER_DEVINFO
-static MixerControl * _new_enum(Mixer * mixer, int index,
-		struct audio_mixer_enum * e, String const * id,
+static MixerControl * _new_enum(Mixer * mixer, MixerControl2 * mc,
+		MixerDeviceInfo const * info, String const * id,
 		String const * icon, String const * name);
-static MixerControl * _new_set(Mixer * mixer, int index,
-		struct audio_mixer_set * s, String const * id,
+static MixerControl * _new_set(Mixer * mixer, MixerControl2 * mc,
+		MixerDeviceInfo const * info, String const * id,
 		String const * icon, String const * name);
-#endif
-static MixerControl * _new_value(Mixer * mixer, int index,
-		GtkSizeGroup * vgroup, String const * id, String const * icon,
-		String const * name);
+static MixerControl * _new_value(Mixer * mixer, MixerControl2 * mc,
+		MixerDeviceInfo const * info, String const * id,
+		String const * icon, String const * name);
+static int _new_get_control(Mixer * mixer, MixerControl2 * mc,
+		MixerDeviceInfo const * info);
+static void _new_load_page(Mixer * mixer, int page);
 /* callbacks */
-static gboolean _new_on_refresh(gpointer data);
+static void _new_on_map(gpointer data);
+static void _new_on_switch_page(GtkWidget * widget, gpointer page,
+		guint page_num, gpointer data);
+static void _new_on_unmap(gpointer data);
+static gboolean _new_on_visibility_notify(GtkWidget * widget,
+		GdkEventVisibility * event, gpointer data);
+static gboolean _new_on_window_state(GtkWidget * widget,
+		GdkEventWindowState * event, gpointer data);
 
 Mixer * mixer_new(GtkWidget * window, String const * device, MixerLayout layout)
 {
 	Mixer * mixer;
-	GtkSizeGroup * hgroup;
-	GtkSizeGroup * vgroup;
 	GtkWidget * scrolled = NULL;
 	GtkWidget * label;
-	GtkWidget * widget;
 	GtkWidget * hvbox = NULL;
-	GtkWidget * hbox;
-	MixerControl * control;
-	MixerControl2 * q;
-	int i;
-#ifdef AUDIO_MIXER_DEVINFO
-	mixer_devinfo_t md;
-	mixer_devinfo_t md2;
 	MixerClass * p;
+	MixerDeviceInfo const * md;
+	size_t cnt;
+	size_t i;
 	size_t u;
-	GtkWidget * vbox2;
 	char * name;
-#else
-	int value;
-	char const * labels[] = SOUND_DEVICE_LABELS;
-	char const * names[] = SOUND_DEVICE_NAMES;
-#endif
 
 	if((mixer = malloc(sizeof(*mixer))) == NULL)
 		return NULL;
 	if(device == NULL)
 		device = MIXER_DEFAULT_DEVICE;
-	mixer->device = string_new(device);
-	mixer->fd = open(device, O_RDWR);
+	mixer->device = mixerdevice_new(device);
 	mixer->window = window;
+	mixer->widget = NULL;
+	mixer->infobar = NULL;
+	mixer->infobar_label = NULL;
 	mixer->properties = NULL;
 	mixer->bold = NULL;
-#ifdef AUDIO_MIXER_DEVINFO
+	mixer->hgroup = NULL;
+	mixer->vgroup = NULL;
 	mixer->classes = NULL;
 	mixer->classes_cnt = 0;
-#endif
 	mixer->controls = NULL;
 	mixer->controls_cnt = 0;
+	mixer->levels = NULL;
+	mixer->shadows = NULL;
+	mixer->levels_cnt = 0;
 	mixer->source = 0;
-	if(mixer->device == NULL || mixer->fd < 0)
+	mixer->refresh_interval = 0;
+	mixer->refresh_changed = FALSE;
+	mixer->refresh_scheduled = FALSE;
+	mixer->mapped = FALSE;
+	mixer->iconified = FALSE;
+	mixer->obscured = FALSE;
+	mixer->pending = NULL;
+	mixer->pending_cnt = 0;
+	mixer->pending_source = 0;
+	mixer->write_interval = MIXER_WRITE_INTERVAL;
+	mixer->writes = 0;
+	mixer->writes_coalesced = 0;
+	mixer->dirty = NULL;
+	mixer->dirty_cnt = 0;
+	mixer->frame_source = 0;
+	mixer->dirty_time = 0;
+	mixer->frames = 0;
+	mixer->frames_dropped = 0;
+	mixer->ui_time = 0;
+	mixer->errors = NULL;
+	mixer->errors_cnt = 0;
+	mixer->errors_total = 0;
+	mixer->thread = NULL;
+	mixer->refreshing = 0;
+	mixer->refreshes = 0;
+	mixer->reads = 0;
+	mixer->refresh_next = SIZE_MAX;
+	mixer->refresh_posting = FALSE;
+	if(mixer->device == NULL)
 	{
 		_mixer_error(NULL, device, 0);
 		mixer_delete(mixer);
 		return NULL;
 	}
-	hgroup = gtk_size_group_new(GTK_SIZE_GROUP_HORIZONTAL);
-	vgroup = gtk_size_group_new(GTK_SIZE_GROUP_VERTICAL);
+	mixer->info_ret = mixerdevice_get_properties(mixer->device,
+			&mixer->info, &mixer->info_error);
+	mixer->hgroup = gtk_size_group_new(GTK_SIZE_GROUP_HORIZONTAL);
+	mixer->vgroup = gtk_size_group_new(GTK_SIZE_GROUP_VERTICAL);
 	/* widgets */
 	mixer->bold = pango_font_description_new();
 	pango_font_description_set_weight(mixer->bold, PANGO_WEIGHT_BOLD);
@@ -237,13 +469,12 @@ Mixer * mixer_new(GtkWidget * window, String const * device, MixerLayout layout)
 			gtk_box_set_homogeneous(GTK_BOX(hvbox), TRUE);
 		_mixer_scrolled_window_add(scrolled, hvbox);
 	}
-	for(i = 0;; i++)
+	cnt = mixerdevice_get_count(mixer->device);
+	for(i = 0; i <= cnt; i++)
 	{
-#ifdef AUDIO_MIXER_DEVINFO
-		md.index = i;
-		if(ioctl(mixer->fd, AUDIO_MIXER_DEVINFO, &md) < 0)
-			break;
-		if(md.type != AUDIO_MIXER_CLASS)
+		/* the last class gathers the controls without one */
+		md = (i < cnt) ? mixerdevice_get_info(mixer->device, i) : NULL;
+		if(md != NULL && md->type != MDT_CLASS)
 			continue;
 		if((p = realloc(mixer->classes, sizeof(*p)
 						* (mixer->classes_cnt + 1)))
@@ -255,173 +486,102 @@ Mixer * mixer_new(GtkWidget * window, String const * device, MixerLayout layout)
 		}
 		mixer->classes = p;
 		p = &mixer->classes[mixer->classes_cnt++];
-		p->mixer_class = md.mixer_class;
-		memcpy(&p->label, &md.label, sizeof(md.label));
+		p->mixer_class = (md != NULL) ? (int)i : -1;
+		p->name = (md != NULL) ? md->name : NULL;
 		p->hbox = NULL;
 		p->page = -1;
-#else
-		hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 4);
-		gtk_container_set_border_width(GTK_CONTAINER(hbox), 2);
-		if(mixer->notebook != NULL)
-		{
-			label = _new_frame_label(NULL, _("All"), NULL);
-			gtk_widget_show_all(label);
-			scrolled = gtk_scrolled_window_new(NULL, NULL);
-			gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(
-						scrolled),
-					GTK_POLICY_AUTOMATIC, GTK_POLICY_NEVER);
-			_mixer_scrolled_window_add(scrolled, hbox);
-			gtk_notebook_append_page(GTK_NOTEBOOK(mixer->notebook),
-					scrolled, label);
-		}
-		else
-			gtk_box_pack_start(GTK_BOX(hvbox), hbox, FALSE, TRUE,
-					0);
-		break;
-#endif
+		p->loaded = FALSE;
 	}
-	/* controls */
-	for(i = 0;; i++)
+	/* pages */
+	for(u = 0; u < mixer->classes_cnt; u++)
 	{
-#ifdef AUDIO_MIXER_DEVINFO
-		md.index = i;
-		if(ioctl(mixer->fd, AUDIO_MIXER_DEVINFO, &md) < 0)
-			break;
-		if(md.type == AUDIO_MIXER_CLASS)
-			continue;
-		for(u = 0; u < mixer->classes_cnt; u++)
-			if(mixer->classes[u].mixer_class == md.mixer_class)
-				break;
-		if(u == mixer->classes_cnt)
-			continue;
-		hbox = mixer->classes[u].hbox;
-		control = NULL;
-		switch(md.type)
+		p = &mixer->classes[u];
+		/* skip the classes without any control */
+		for(i = 0; i < cnt; i++)
 		{
-			case AUDIO_MIXER_ENUM:
-				control = _new_enum(mixer, i, &md.un.e,
-						md.label.name,
-						_mixer_get_icon(md.label.name),
-						md.label.name);
-				break;
-			case AUDIO_MIXER_SET:
-				control = _new_set(mixer, i, &md.un.s,
-						md.label.name,
-						_mixer_get_icon(md.label.name),
-						md.label.name);
-				break;
-			case AUDIO_MIXER_VALUE:
-				control = _new_value(mixer, i, vgroup,
-						md.label.name,
-						_mixer_get_icon(md.label.name),
-						md.label.name);
+			md = mixerdevice_get_info(mixer->device, i);
+			if(md->type != MDT_CLASS
+					&& md->mixer_class == p->mixer_class)
 				break;
 		}
-		if(control == NULL)
+		if(i == cnt)
 			continue;
-		if((q = realloc(mixer->controls, sizeof(*q)
-						* (mixer->controls_cnt + 1)))
-				== NULL)
-		{
-			mixercontrol_delete(control);
-			/* FIXME report error */
-			continue;
-		}
-		mixer->controls = q;
-		q = &mixer->controls[mixer->controls_cnt++];
-		q->index = md.index;
-		q->type = md.type;
-		q->control = control;
-		widget = mixercontrol_get_widget(control);
-		vbox2 = gtk_box_new(GTK_ORIENTATION_VERTICAL, 4);
-		gtk_box_pack_start(GTK_BOX(vbox2), widget, TRUE, TRUE, 0);
-		gtk_size_group_add_widget(hgroup, widget);
-		if(hbox == NULL)
+		p->hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 4);
+		gtk_container_set_border_width(GTK_CONTAINER(p->hbox), 2);
+		if(mixer->notebook != NULL)
 		{
-			p = &mixer->classes[u];
-			p->hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 4);
-			hbox = p->hbox;
-			gtk_container_set_border_width(GTK_CONTAINER(hbox), 2);
-			if(mixer->notebook != NULL)
+			if(p->name == NULL)
+				label = _new_frame_label(NULL, _("All"), NULL);
+			else
 			{
-				if((name = strdup(mixer->classes[u].label.name))
-						!= NULL)
-					name[0] = toupper(
-							(unsigned char)name[0]);
-				label = _new_frame_label(NULL,
-						mixer->classes[u].label.name,
-						name);
+				if((name = strdup(p->name)) != NULL)
+					name[0] = toupper((unsigned char)name[0]);
+				label = _new_frame_label(NULL, p->name, name);
 				free(name);
-				gtk_widget_show_all(label);
-				scrolled = gtk_scrolled_window_new(NULL, NULL);
-				gtk_scrolled_window_set_policy(
-						GTK_SCROLLED_WINDOW(scrolled),
-						GTK_POLICY_AUTOMATIC,
-						GTK_POLICY_NEVER);
-				_mixer_scrolled_window_add(scrolled, p->hbox);
-				p->page = gtk_notebook_append_page(
-						GTK_NOTEBOOK(mixer->notebook),
-						scrolled, label);
 			}
-			else if(hvbox != NULL)
-				gtk_box_pack_start(GTK_BOX(hvbox), p->hbox,
-						FALSE, TRUE, 0);
+			gtk_widget_show_all(label);
+			scrolled = gtk_scrolled_window_new(NULL, NULL);
+			gtk_scrolled_window_set_policy(
+					GTK_SCROLLED_WINDOW(scrolled),
+					GTK_POLICY_AUTOMATIC, GTK_POLICY_NEVER);
+			_mixer_scrolled_window_add(scrolled, p->hbox);
+			p->page = gtk_notebook_append_page(
+					GTK_NOTEBOOK(mixer->notebook), scrolled,
+					label);
+		}
+		else
+		{
+			gtk_box_pack_start(GTK_BOX(hvbox), p->hbox, FALSE, TRUE,
+					0);
+			_mixer_load_class(mixer, p);
 		}
-		gtk_box_pack_start(GTK_BOX(hbox), vbox2, FALSE, TRUE, 0);
-		/* add a mute button if relevant */
-		if(md.type != AUDIO_MIXER_VALUE)
-			continue;
-		md2.index = md.index + 1;
-		if(ioctl(mixer->fd, AUDIO_MIXER_DEVINFO, &md2) < 0)
-			break;
-		if(md2.type == AUDIO_MIXER_CLASS)
-			continue;
-		for(u = 0; u < mixer->classes_cnt; u++)
-			if(mixer->classes[u].mixer_class == md2.mixer_class)
-				break;
-		if(u == mixer->classes_cnt)
-			continue;
-		u = strlen(md.label.name);
-		if(md2.type != AUDIO_MIXER_ENUM || strncmp(md.label.name,
-					md2.label.name, u) != 0
-				|| (u = strlen(md2.label.name)) < 6
-				|| strcmp(&md2.label.name[u - 5], ".mute") != 0)
-			continue;
-		/* XXX may fail */
-		mixercontrol_set(control, "show-mute", TRUE, NULL);
-		i++;
-#else
-		if(i == SOUND_MIXER_NONE)
-			break;
-		if(ioctl(mixer->fd, MIXER_READ(i), &value) != 0)
-			continue;
-		if((q = realloc(mixer->controls, sizeof(*q)
-						* (mixer->controls_cnt + 1)))
-				== NULL)
-			/* FIXME report error */
-			continue;
-		mixer->controls = q;
-		q = &mixer->controls[mixer->controls_cnt];
-		if((control = _new_value(mixer, i, vgroup, names[i],
-						_mixer_get_icon(names[i]),
-						labels[i]))
-				== NULL)
-			continue;
-		q->index = i;
-		q->type = 0;
-		q->control = control;
-		mixer->controls_cnt++;
-		widget = mixercontrol_get_widget(control);
-		gtk_size_group_add_widget(hgroup, widget);
-		gtk_box_pack_start(GTK_BOX(hbox), widget, FALSE, TRUE, 0);
-#endif
 	}
-	mixer->widget = (mixer->notebook != NULL) ? mixer->notebook : scrolled;
-#ifdef AUDIO_MIXER_DEVINFO
-	mixer_show_class(mixer, AudioCoutputs);
+	/* errors are reported above the controls */
+	mixer->widget = gtk_box_new(GTK_ORIENTATION_VERTICAL, 0);
+#if GTK_CHECK_VERSION(2, 18, 0)
+	mixer->infobar = gtk_info_bar_new_with_buttons(GTK_STOCK_CLOSE,
+			GTK_RESPONSE_CLOSE, NULL);
+	gtk_info_bar_set_message_type(GTK_INFO_BAR(mixer->infobar),
+			GTK_MESSAGE_ERROR);
+	mixer->infobar_label = gtk_label_new(NULL);
+	gtk_label_set_line_wrap(GTK_LABEL(mixer->infobar_label), TRUE);
+	gtk_container_add(GTK_CONTAINER(gtk_info_bar_get_content_area(
+					GTK_INFO_BAR(mixer->infobar))),
+			mixer->infobar_label);
+	g_signal_connect(mixer->infobar, "response", G_CALLBACK(
+				gtk_widget_hide), NULL);
+	gtk_widget_show_all(mixer->infobar);
+	gtk_widget_hide(mixer->infobar);
+	gtk_widget_set_no_show_all(mixer->infobar, TRUE);
+	gtk_box_pack_start(GTK_BOX(mixer->widget), mixer->infobar, FALSE, TRUE,
+			0);
 #endif
+	gtk_box_pack_start(GTK_BOX(mixer->widget), (mixer->notebook != NULL)
+			? mixer->notebook : scrolled, TRUE, TRUE, 0);
+	/* the other pages are only populated once switched to */
+	if(mixer->notebook != NULL)
+		g_signal_connect(mixer->notebook, "switch-page", G_CALLBACK(
+					_new_on_switch_page), mixer);
+	mixer_show_class(mixer, MIXER_CLASS_OUTPUTS);
+	if(mixer->notebook != NULL)
+		_new_load_page(mixer, gtk_notebook_get_current_page(
+					GTK_NOTEBOOK(mixer->notebook)));
 	gtk_widget_show_all(mixer->widget);
-	mixer->source = g_timeout_add(500, _new_on_refresh, mixer);
+	/* the device is only accessed from the thread from now on, if any */
+	_mixer_start_thread(mixer);
+	/* the controls are only refreshed while visible */
+	g_signal_connect_swapped(mixer->widget, "map", G_CALLBACK(_new_on_map),
+			mixer);
+	g_signal_connect_swapped(mixer->widget, "unmap", G_CALLBACK(
+				_new_on_unmap), mixer);
+	if(window != NULL)
+	{
+		gtk_widget_add_events(window, GDK_VISIBILITY_NOTIFY_MASK);
+		g_signal_connect(window, "visibility-notify-event", G_CALLBACK(
+					_new_on_visibility_notify), mixer);
+		g_signal_connect(window, "window-state-event", G_CALLBACK(
+					_new_on_window_state), mixer);
+	}
 	return mixer;
 }
 
@@ -456,125 +616,238 @@ static GtkWidget * _new_frame_label(GdkPixbuf * pixbuf, char const * name,
 	return hbox;
 }
 
-#ifdef AUDIO_MIXER_DEVINFO
-static MixerControl * _new_enum(Mixer * mixer, int index,
-		struct audio_mixer_enum * e, String const * id,
+static MixerControl * _new_enum(Mixer * mixer, MixerControl2 * mc,
+		MixerDeviceInfo const * info, String const * id,
 		String const * icon, String const * name)
 {
-	MixerControl2 mc;
 	MixerControl * control;
-	int i;
+	size_t i;
 	char label[16];
 	char value[16];
 
-	if(e->num_mem <= 0)
+	if(info->members_cnt == 0)
 		return NULL;
-	mc.index = index;
-	if(_mixer_get_control(mixer, &mc) != 0
+	mc->kind = MCK_RADIO;
+	if(_new_get_control(mixer, mc, info) != 0
 			|| (control = mixercontrol_new(mixer, id, icon, name,
-					"radio", "members", e->num_mem, NULL))
+					_mixer_kinds[mc->kind].type, "members",
+					(unsigned int)info->members_cnt, NULL))
 			== NULL)
 		return NULL;
-	for(i = 0; i < e->num_mem; i++)
+	mc->control = control;
+	for(i = 0; i < info->members_cnt; i++)
 	{
-		snprintf(label, sizeof(label), "label%d", i);
-		snprintf(value, sizeof(value), "value%d", i);
-		if(mixercontrol_set(control, label, e->member[i].label.name,
-					value, e->member[i].ord, NULL) != 0)
+		snprintf(label, sizeof(label), "label%zu", i);
+		snprintf(value, sizeof(value), "value%zu", i);
+		if(mixercontrol_set(control, label, info->members[i].name,
+					value, info->members[i].value, NULL)
+				!= 0)
 		{
 			mixercontrol_delete(control);
 			return NULL;
 		}
 	}
-	if(_mixer_set_control_widget(mixer, &mc) != 0)
+	if(_mixer_set_control_widget(mixer, mc) != 0)
 	{
 		mixercontrol_delete(control);
 		return NULL;
 	}
+	_mixer_shadow_control(mixer, mc);
+	mc->sensitive = TRUE;
 	return control;
 }
 
-static MixerControl * _new_set(Mixer * mixer, int index,
-		struct audio_mixer_set * s, String const * id,
+static MixerControl * _new_set(Mixer * mixer, MixerControl2 * mc,
+		MixerDeviceInfo const * info, String const * id,
 		String const * icon, String const * name)
 {
-	MixerControl2 mc;
 	MixerControl * control;
-	int i;
+	size_t i;
 	char label[16];
 	char value[16];
 
-	if(s->num_mem <= 0)
+	if(info->members_cnt == 0)
 		return NULL;
-	mc.index = index;
-	if(_mixer_get_control(mixer, &mc) != 0
+	mc->kind = MCK_SET;
+	if(_new_get_control(mixer, mc, info) != 0
 			|| (control = mixercontrol_new(mixer, id, icon, name,
-					"set", "members", s->num_mem, NULL))
+					_mixer_kinds[mc->kind].type, "members",
+					(unsigned int)info->members_cnt, NULL))
 			== NULL)
 		return NULL;
-	mc.control = control;
-	for(i = 0; i < s->num_mem; i++)
+	mc->control = control;
+	for(i = 0; i < info->members_cnt; i++)
 	{
-		snprintf(label, sizeof(label), "label%d", i);
-		snprintf(value, sizeof(value), "value%d", i);
-		if(mixercontrol_set(control, label, s->member[i].label.name,
-					value, s->member[i].mask, NULL) != 0)
+		snprintf(label, sizeof(label), "label%zu", i);
+		snprintf(value, sizeof(value), "value%zu", i);
+		if(mixercontrol_set(control, label, info->members[i].name,
+					value, info->members[i].value, NULL)
+				!= 0)
 		{
 			mixercontrol_delete(control);
 			return NULL;
 		}
 	}
-	if(_mixer_set_control_widget(mixer, &mc) != 0)
+	if(_mixer_set_control_widget(mixer, mc) != 0)
 	{
 		mixercontrol_delete(control);
 		return NULL;
 	}
+	_mixer_shadow_control(mixer, mc);
+	mc->sensitive = TRUE;
 	return control;
 }
-#endif /* AUDIO_MIXER_DEVINFO */
 
-static MixerControl * _new_value(Mixer * mixer, int index,
-		GtkSizeGroup * vgroup, String const * id, String const * icon,
-		String const * name)
+static MixerControl * _new_value(Mixer * mixer, MixerControl2 * mc,
+		MixerDeviceInfo const * info, String const * id,
+		String const * icon, String const * name)
 {
-	MixerControl2 mc;
 	MixerControl * control;
-	size_t i;
-	gboolean bind = TRUE;
 
-	mc.index = index;
-	if(_mixer_get_control(mixer, &mc) != 0
-			|| mc.un.level.channels_cnt <= 0
+	mc->kind = MCK_CHANNELS;
+	if(_new_get_control(mixer, mc, info) != 0
+			|| mc->channels_cnt <= 0
 			|| (control = mixercontrol_new(mixer, id, icon, name,
-					"channels",
-					"channels", mc.un.level.channels_cnt,
-					"delta", mc.un.level.delta,
-					"vgroup", vgroup, NULL)) == NULL)
+					_mixer_meters ? "meter"
+					: _mixer_kinds[mc->kind].type,
+					"channels", (size_t)mc->channels_cnt,
+					"delta", (unsigned int)mc->delta,
+					"vgroup", mixer->vgroup, NULL)) == NULL)
 		return NULL;
-	mc.control = control;
-	/* detect if binding is in place */
-	for(i = 1; i < mc.un.level.channels_cnt; i++)
-		if(mc.un.level.channels[i] != mc.un.level.channels[0])
-		{
-			bind = FALSE;
-			break;
-		}
-	if(mixercontrol_set(control, "bind", bind, NULL) != 0
-			|| _mixer_set_control_widget(mixer, &mc) != 0)
+	mc->control = control;
+	/* detect if binding is in place, unless still to be read */
+	if(mixercontrol_set_property(control, MCP_BIND, mc->fresh
+				|| _mixer_get_bind(mixer, mc)) != 0
+			|| _mixer_set_control_widget(mixer, mc) != 0)
 	{
 		mixercontrol_delete(control);
 		return NULL;
 	}
+	_mixer_shadow_control(mixer, mc);
+	mc->sensitive = TRUE;
 	return control;
 }
 
+static int _new_get_control(Mixer * mixer, MixerControl2 * mc,
+		MixerDeviceInfo const * info)
+{
+	int ret;
+	char const * error = NULL;
+	uint8_t * p;
+	MixerValue value;
+
+	mc->value = 0;
+	mc->level = mixer->levels_cnt;
+	mc->channels_cnt = 0;
+	mc->delta = 0;
+	/* the levels are stored next to those of the previous controls */
+	if(info->type == MDT_VALUE)
+	{
+		if(info->channels_cnt > MIXERDEVICE_CHANNELS_MAX)
+			return -ERANGE;
+		if((p = realloc(mixer->levels, mixer->levels_cnt
+						+ info->channels_cnt)) == NULL)
+			return -_mixer_error(mixer, "realloc", 1);
+		mixer->levels = p;
+		if((p = realloc(mixer->shadows, mixer->levels_cnt
+						+ info->channels_cnt)) == NULL)
+			return -_mixer_error(mixer, "realloc", 1);
+		mixer->shadows = p;
+		memset(&mixer->levels[mc->level], 0, info->channels_cnt);
+		mixer->levels_cnt += info->channels_cnt;
+		mc->channels_cnt = info->channels_cnt;
+		mc->delta = info->delta;
+	}
+	/* the device belongs to the thread, which reads the control later */
+	if(mixer->thread != NULL)
+		return 0;
+	if((ret = mixerdevice_get_value(mixer->device, mc->index, &value,
+					&error)) != 0)
+	{
+		if(ret != -ENXIO)
+		{
+			errno = -ret;
+			_mixer_error(mixer, error, 1);
+		}
+		return ret;
+	}
+	_mixer_set_value(mixer, mc, &value);
+	return 0;
+}
+
+static void _new_load_page(Mixer * mixer, int page)
+{
+	size_t u;
+
+	if(page < 0)
+		return;
+	for(u = 0; u < mixer->classes_cnt; u++)
+		if(mixer->classes[u].page == page)
+		{
+			_mixer_load_class(mixer, &mixer->classes[u]);
+			break;
+		}
+}
+
 /* callbacks */
-static gboolean _new_on_refresh(gpointer data)
+static void _new_on_map(gpointer data)
 {
 	Mixer * mixer = data;
 
-	mixer_refresh(mixer);
-	return TRUE;
+	mixer->mapped = TRUE;
+	_mixer_schedule_refresh(mixer, MIXER_REFRESH_FAST);
+}
+
+static void _new_on_switch_page(GtkWidget * widget, gpointer page,
+		guint page_num, gpointer data)
+{
+	Mixer * mixer = data;
+	size_t u;
+	(void) widget;
+	(void) page;
+
+	for(u = 0; u < mixer->classes_cnt; u++)
+		if(mixer->classes[u].page == (int)page_num)
+			break;
+	if(u == mixer->classes_cnt)
+		return;
+	/* the controls were not refreshed while hidden */
+	if(mixer->classes[u].loaded)
+		_mixer_refresh_class(mixer, &mixer->classes[u]);
+	else
+		_mixer_load_class(mixer, &mixer->classes[u]);
+}
+
+static void _new_on_unmap(gpointer data)
+{
+	Mixer * mixer = data;
+
+	mixer->mapped = FALSE;
+	_mixer_schedule_refresh(mixer, 0);
+}
+
+static gboolean _new_on_visibility_notify(GtkWidget * widget,
+		GdkEventVisibility * event, gpointer data)
+{
+	Mixer * mixer = data;
+	(void) widget;
+
+	mixer->obscured = (event->state == GDK_VISIBILITY_FULLY_OBSCURED)
+		? TRUE : FALSE;
+	_mixer_schedule_refresh(mixer, MIXER_REFRESH_FAST);
+	return FALSE;
+}
+
+static gboolean _new_on_window_state(GtkWidget * widget,
+		GdkEventWindowState * event, gpointer data)
+{
+	Mixer * mixer = data;
+	(void) widget;
+
+	mixer->iconified = (event->new_window_state
+			& GDK_WINDOW_STATE_ICONIFIED) ? TRUE : FALSE;
+	_mixer_schedule_refresh(mixer, MIXER_REFRESH_FAST);
+	return FALSE;
 }
 
 
@@ -583,15 +856,49 @@ void mixer_delete(Mixer * mixer)
 {
 	size_t i;
 
+	/* the widgets may outlive the mixer */
+	if(mixer->window != NULL)
+		g_signal_handlers_disconnect_matched(mixer->window,
+				G_SIGNAL_MATCH_DATA, 0, 0, NULL, NULL, mixer);
+	if(mixer->widget != NULL)
+		g_signal_handlers_disconnect_matched(mixer->widget,
+				G_SIGNAL_MATCH_DATA, 0, 0, NULL, NULL, mixer);
 	if(mixer->source > 0)
 		g_source_remove(mixer->source);
+	_mixer_flush(mixer);
+	if(mixer->pending_source > 0)
+		g_source_remove(mixer->pending_source);
+	if(mixer->frame_source > 0)
+#if GTK_CHECK_VERSION(3, 8, 0)
+		gtk_widget_remove_tick_callback(mixer->widget,
+				mixer->frame_source);
+#else
+		g_source_remove(mixer->frame_source);
+#endif
+	/* let the thread complete the last writes */
+	if(mixer->thread != NULL)
+		_mixer_stop_thread(mixer);
+	/* write those which did not fit in the commands directly */
+	mixer->pending_source = 0;
+	if(mixer->pending_cnt > 0)
+		_mixer_flush(mixer);
+	free(mixer->pending);
+	free(mixer->dirty);
 	for(i = 0; i < mixer->controls_cnt; i++)
 		mixercontrol_delete(mixer->controls[i].control);
 	free(mixer->controls);
-	if(mixer->fd >= 0)
-		close(mixer->fd);
+	free(mixer->levels);
+	free(mixer->shadows);
+	free(mixer->classes);
+	for(i = 0; i < mixer->errors_cnt; i++)
+		string_delete(mixer->errors[i].message);
+	free(mixer->errors);
+	if(mixer->hgroup != NULL)
+		g_object_unref(mixer->hgroup);
+	if(mixer->vgroup != NULL)
+		g_object_unref(mixer->vgroup);
 	if(mixer->device != NULL)
-		string_delete(mixer->device);
+		mixerdevice_delete(mixer->device);
 	if(mixer->bold != NULL)
 		pango_font_description_free(mixer->bold);
 	free(mixer);
@@ -599,37 +906,57 @@ void mixer_delete(Mixer * mixer)
 
 
 /* accessors */
+/* mixer_get_control */
+MixerControl * mixer_get_control(Mixer * mixer, String const * id)
+{
+	size_t i;
+
+	for(i = 0; i < mixer->controls_cnt; i++)
+		if(string_compare(mixercontrol_get_id(
+						mixer->controls[i].control), id)
+				== 0)
+			return mixer->controls[i].control;
+	return NULL;
+}
+
+
 /* mixer_get_properties */
 int mixer_get_properties(Mixer * mixer, MixerProperties * properties)
 {
-#ifdef AUDIO_MIXER_DEVINFO
-	audio_device_t ad;
-
-	if(ioctl(mixer->fd, AUDIO_GETDEV, &ad) != 0)
-		return -_mixer_error(mixer, "AUDIO_GETDEV", 1);
-	snprintf(properties->name, sizeof(properties->name), "%s", ad.name);
-	snprintf(properties->version, sizeof(properties->version), "%s",
-			ad.version);
-	snprintf(properties->device, sizeof(properties->device), "%s",
-			ad.config);
-#else
-	struct mixer_info mi;
-	int version;
-
-	if(ioctl(mixer->fd, SOUND_MIXER_INFO, &mi) != 0)
-		return -_mixer_error(mixer, "SOUND_MIXER_INFO", 1);
-	if(ioctl(mixer->fd, OSS_GETVERSION, &version) != 0)
-		return -_mixer_error(mixer, "OSS_GETVERSION", 1);
-	snprintf(properties->name, sizeof(properties->name), "%s", mi.name);
-	snprintf(properties->version, sizeof(properties->version), "%u.%u",
-			(version >> 16) & 0xffff, version & 0xffff);
-	snprintf(properties->device, sizeof(properties->device), "%s",
-			mixer->device);
-#endif
+	/* obtained once from the device, before starting the thread */
+	if(mixer->info_ret != 0)
+	{
+		errno = -mixer->info_ret;
+		return -_mixer_error(mixer, mixer->info_error, 1);
+	}
+	*properties = mixer->info;
 	return 0;
 }
 
 
+/* mixer_get_stats */
+void mixer_get_stats(Mixer * mixer, MixerStats * stats)
+{
+	stats->errors = mixer->errors_total;
+	stats->frames = mixer->frames;
+	stats->frames_dropped = mixer->frames_dropped;
+	stats->ioctls = mixerdevice_get_ioctls(mixer->device);
+	stats->plugins = mixercontrol_get_loaded();
+	stats->reads = mixer->reads;
+	stats->refreshes = mixer->refreshes;
+	stats->ui_time = mixer->ui_time;
+	stats->writes = mixer->writes;
+	stats->writes_coalesced = mixer->writes_coalesced;
+}
+
+
+/* mixer_get_refresh_interval */
+unsigned int mixer_get_refresh_interval(Mixer * mixer)
+{
+	return mixer->refresh_interval;
+}
+
+
 /* mixer_get_widget */
 GtkWidget * mixer_get_widget(Mixer * mixer)
 {
@@ -638,162 +965,182 @@ GtkWidget * mixer_get_widget(Mixer * mixer)
 
 
 /* mixer_set */
-static int _set_channels(Mixer * mixer, MixerControl * control);
-#if defined(AUDIO_MIXER_DEVINFO)
-static int _set_mute(Mixer * mixer, MixerControl * control);
-static int _set_radio(Mixer * mixer, MixerControl * control);
-static int _set_set(Mixer * mixer, MixerControl * control);
-#endif
+static gboolean _set_on_flush(gpointer data);
 
 int mixer_set(Mixer * mixer, MixerControl * control)
 {
-	String const * type;
+	int ret;
+	MixerControl2 * mc;
+	size_t * p;
 
 #ifdef DEBUG
 	fprintf(stderr, "DEBUG: %s()\n", __func__);
 #endif
-	if((type = mixercontrol_get_type(control)) == NULL)
+	if((mc = _mixer_get_control2(mixer, control)) == NULL
+			|| _mixer_kinds[mc->kind].set == NULL)
 		return -1;
-	else if(string_compare(type, "channels") == 0)
-		return _set_channels(mixer, control);
-#if defined(AUDIO_MIXER_DEVINFO)
-	else if(string_compare(type, "mute") == 0)
-		return _set_mute(mixer, control);
-	else if(string_compare(type, "radio") == 0)
-		return _set_radio(mixer, control);
-	else if(string_compare(type, "set") == 0)
-		return _set_set(mixer, control);
-#endif
-	return -1;
+	/* follow the changes closely while the user is active */
+	_mixer_schedule_refresh(mixer, MIXER_REFRESH_FAST);
+	/* queue the write anyway if the thread is busy */
+	if(mixer->write_interval == 0 && mc->pending == FALSE
+			&& (ret = _mixer_kinds[mc->kind].set(mixer, mc))
+			!= -EAGAIN)
+	{
+		if(mixer->thread != NULL)
+			_mixer_notify(mixer->thread->wake[1]);
+		return ret;
+	}
+	/* the latest value is read from the widget when flushing */
+	if(mc->pending)
+	{
+		mixer->writes_coalesced++;
+		return 0;
+	}
+	if((p = realloc(mixer->pending, sizeof(*p) * (mixer->pending_cnt
+						+ 1))) == NULL)
+		return -1;
+	mixer->pending = p;
+	mixer->pending[mixer->pending_cnt++] = mc - mixer->controls;
+	mc->pending = TRUE;
+	if(mixer->pending_source == 0)
+		mixer->pending_source = g_timeout_add(MAX(mixer->write_interval,
+					1), _set_on_flush, mixer);
+	return 0;
 }
 
-static int _set_channels(Mixer * mixer, MixerControl * control)
+static gboolean _set_on_flush(gpointer data)
 {
-	size_t i;
-	double value;
-	MixerControl2 * mc;
-	char buf[16];
+	Mixer * mixer = data;
+
+	mixer->pending_source = 0;
+	_mixer_flush(mixer);
+	/* the flush is re-scheduled if the thread was busy */
+	return FALSE;
+}
 
+static int _set_channels(Mixer * mixer, MixerControl2 * mc)
+{
+	int ret;
 #ifdef DEBUG
-	fprintf(stderr, "DEBUG: %s(%p, %p) fd=%d\n", __func__, (void *)mixer,
-			(void *)control, mixer->fd);
+	size_t i;
+
+	fprintf(stderr, "DEBUG: %s(%p, %p)\n", __func__, (void *)mixer,
+			(void *)mc->control);
 #endif
-	for(i = 0; i < mixer->controls_cnt; i++)
-		if(mixer->controls[i].control == control)
-			break;
-	if(i == mixer->controls_cnt)
-		return -1;
-	mc = &mixer->controls[i];
-	if(_mixer_get_control(mixer, mc) != 0)
+	if(mixercontrol_get_levels(mc->control, &mixer->levels[mc->level],
+				mc->channels_cnt) != 0)
 		return -1;
-	for(i = 0; i < mc->un.level.channels_cnt; i++)
-	{
-		snprintf(buf, sizeof(buf), "value%zu", i);
-		if(mixercontrol_get(control, buf, &value, NULL) != 0)
-			return -1;
 #ifdef DEBUG
-		fprintf(stderr, "DEBUG: %s() value%zu=%f\n",
-				__func__, i, value);
+	for(i = 0; i < mc->channels_cnt; i++)
+		fprintf(stderr, "DEBUG: %s() value%zu=%u\n", __func__, i,
+				mixer->levels[mc->level + i]);
 #endif
-		mc->un.level.channels[i] = (value * 255.0) / 100.0;
-	}
-	return _mixer_set_control(mixer, mc);
+	/* the levels may not have changed after rounding */
+	if(_mixer_compare_control(mixer, mc) == 0)
+		return 0;
+	/* the widget is up to date once the levels are written */
+	if((ret = _mixer_write_control(mixer, mc)) == 0)
+		_mixer_shadow_control(mixer, mc);
+	return ret;
 }
 
-#if defined(AUDIO_MIXER_DEVINFO)
-static int _set_mute(Mixer * mixer, MixerControl * control)
+static int _set_mute(Mixer * mixer, MixerControl2 * mc)
 {
-	size_t i;
-	gboolean value;
-	MixerControl2 * mc;
-	mixer_ctrl_t p;
+	unsigned int value;
 
-# ifdef DEBUG
-	fprintf(stderr, "DEBUG: %s(%p, %p) fd=%d\n", __func__, (void *)mixer,
-			(void *)control, mixer->fd);
-# endif
-	for(i = 0; i < mixer->controls_cnt; i++)
-		if(mixer->controls[i].control == control)
-			break;
-	if(i == mixer->controls_cnt)
-		return -1;
-	mc = &mixer->controls[i];
-	p.dev = mc->index;
-	p.type = mc->type;
-	if(mixercontrol_get(control, "value", &value, NULL) != 0)
+#ifdef DEBUG
+	fprintf(stderr, "DEBUG: %s(%p, %p)\n", __func__, (void *)mixer,
+			(void *)mc->control);
+#endif
+	if(mixercontrol_get_property(mc->control, MCP_VALUE, &value) != 0)
 		return -1;
-	p.un.ord = value;
-# ifdef DEBUG
-	fprintf(stderr, "DEBUG: %s() ord=%d\n", __func__, p.un.ord);
-# endif
-	if(ioctl(mixer->fd, AUDIO_MIXER_WRITE, &p) != 0)
-		return -_mixer_error(mixer, "AUDIO_MIXER_WRITE", 1);
-	return 0;
-}
+	mc->value = value;
+#ifdef DEBUG
+	fprintf(stderr, "DEBUG: %s() ord=%d\n", __func__, mc->value);
+#endif
+	/* the widget is already up to date */
+	_mixer_shadow_control(mixer, mc);
+	return _mixer_write_control(mixer, mc);
+}
 
-static int _set_radio(Mixer * mixer, MixerControl * control)
+static int _set_radio(Mixer * mixer, MixerControl2 * mc)
 {
-	size_t i;
-	MixerControl2 * mc;
-	mixer_ctrl_t p;
 	unsigned int value;
 
-# ifdef DEBUG
-	fprintf(stderr, "DEBUG: %s(%p) fd=%d\n", __func__, (void *)mixer,
-			mixer->fd);
-# endif
-	for(i = 0; i < mixer->controls_cnt; i++)
-		if(mixer->controls[i].control == control)
-			break;
-	if(i == mixer->controls_cnt)
-		return -1;
-	mc = &mixer->controls[i];
-	p.dev = mc->index;
-	p.type = mc->type;
-	if(mixercontrol_get(control, "value", &value, NULL) != 0)
+#ifdef DEBUG
+	fprintf(stderr, "DEBUG: %s(%p, %p)\n", __func__, (void *)mixer,
+			(void *)mc->control);
+#endif
+	if(mixercontrol_get_property(mc->control, MCP_VALUE, &value) != 0)
 		return -1;
-	p.un.ord = value;
-# ifdef DEBUG
-	fprintf(stderr, "DEBUG: %s() ord=%d\n", __func__, p.un.ord);
-# endif
-	if(ioctl(mixer->fd, AUDIO_MIXER_WRITE, &p) != 0)
-		return -_mixer_error(mixer, "AUDIO_MIXER_WRITE", 1);
-	return 0;
+	mc->value = value;
+#ifdef DEBUG
+	fprintf(stderr, "DEBUG: %s() ord=%d\n", __func__, mc->value);
+#endif
+	/* the widget is already up to date */
+	_mixer_shadow_control(mixer, mc);
+	return _mixer_write_control(mixer, mc);
 }
 
-static int _set_set(Mixer * mixer, MixerControl * control)
+static int _set_set(Mixer * mixer, MixerControl2 * mc)
 {
-	size_t i;
 	unsigned int value;
-	MixerControl2 * mc;
-	mixer_ctrl_t p;
 
-# ifdef DEBUG
-	fprintf(stderr, "DEBUG: %s(%p) fd=%d\n", __func__, (void *)mixer,
-			mixer->fd);
-# endif
-	for(i = 0; i < mixer->controls_cnt; i++)
-		if(mixer->controls[i].control == control)
-			break;
-	if(i == mixer->controls_cnt)
-		return -1;
-	mc = &mixer->controls[i];
-	p.dev = mc->index;
-	p.type = mc->type;
-	if(mixercontrol_get(control, "value", &value, NULL) != 0)
+#ifdef DEBUG
+	fprintf(stderr, "DEBUG: %s(%p, %p)\n", __func__, (void *)mixer,
+			(void *)mc->control);
+#endif
+	if(mixercontrol_get_property(mc->control, MCP_VALUE, &value) != 0)
 		return -1;
-	p.un.mask = value;
-# ifdef DEBUG
-	fprintf(stderr, "DEBUG: %s() mask=%d\n", __func__, p.un.mask);
-# endif
-	if(ioctl(mixer->fd, AUDIO_MIXER_WRITE, &p) != 0)
-		return -_mixer_error(mixer, "AUDIO_MIXER_WRITE", 1);
-	return 0;
-}
+	mc->value = value;
+#ifdef DEBUG
+	fprintf(stderr, "DEBUG: %s() mask=%d\n", __func__, mc->value);
 #endif
+	/* the widget is already up to date */
+	_mixer_shadow_control(mixer, mc);
+	return _mixer_write_control(mixer, mc);
+}
+
+
+/* mixer_set_meters */
+void mixer_set_meters(gboolean meters)
+{
+	_mixer_meters = meters;
+}
+
+
+/* mixer_set_write_interval */
+void mixer_set_write_interval(Mixer * mixer, unsigned int interval)
+{
+	mixer->write_interval = interval;
+	if(interval == 0 && mixer->pending_source > 0)
+	{
+		g_source_remove(mixer->pending_source);
+		mixer->pending_source = 0;
+		_mixer_flush(mixer);
+	}
+}
 
 
 /* useful */
+/* mixer_print_stats */
+void mixer_print_stats(Mixer * mixer, FILE * fp)
+{
+	MixerStats stats;
+
+	mixer_get_stats(mixer, &stats);
+	fprintf(fp, "errors=%lu ioctls=%lu plugins=%lu reads=%lu"
+			" refreshes=%lu writes=%lu coalesced=%lu\n",
+			stats.errors, stats.ioctls, stats.plugins, stats.reads,
+			stats.refreshes, stats.writes, stats.writes_coalesced);
+	fprintf(fp, "frames=%lu dropped=%lu ui=%luus ui/refresh=%luus\n",
+			stats.frames, stats.frames_dropped, stats.ui_time,
+			(stats.refreshes > 0)
+			? stats.ui_time / stats.refreshes : 0);
+	mixerdevice_print_stats(mixer->device, fp);
+}
+
+
 /* mixer_properties */
 static GtkWidget * _properties_label(Mixer * mixer, GtkSizeGroup * group,
 		char const * label, char const * value);
@@ -889,9 +1236,60 @@ int mixer_refresh(Mixer * mixer)
 {
 	int ret = 0;
 	size_t i;
+	MixerMessage message;
+	gint64 start;
+#ifdef DEBUG
+	unsigned long ioctls;
+	size_t cnt = 0;
+#endif
 
+	if(mixer->thread != NULL)
+	{
+		/* the previous refresh is still in progress */
+		if(mixer->refreshing > 0)
+			return 0;
+		/* the controls are read once the thread reports a change */
+		message.type = MMT_REFRESH;
+		if(_mixer_post(mixer, &message) == 0)
+		{
+			mixer->refreshing++;
+			_mixer_notify(mixer->thread->wake[1]);
+		}
+		return 0;
+	}
+	/* the refresh completes synchronously */
+	start = g_get_monotonic_time();
+	/* skip the controls altogether if the driver reports no change */
+	if(mixerdevice_get_modified(mixer->device) == 0)
+	{
+		mixer->ui_time += g_get_monotonic_time() - start;
+		_mixer_refreshed(mixer);
+		return 0;
+	}
+#ifdef DEBUG
+	ioctls = mixerdevice_get_ioctls(mixer->device);
+#endif
 	for(i = 0; i < mixer->controls_cnt; i++)
+	{
+		/* the widget is ahead of the hardware until written */
+		if(mixer->controls[i].pending
+				|| !_mixer_get_visible(mixer,
+					&mixer->controls[i])
+				|| mixerdevice_get_changed(mixer->device,
+					mixer->controls[i].index) == 0)
+			continue;
 		ret |= _mixer_refresh_control(mixer, &mixer->controls[i]);
+#ifdef DEBUG
+		cnt++;
+#endif
+	}
+#ifdef DEBUG
+	fprintf(stderr, "DEBUG: %s() %lu ioctls for %zu/%zu controls\n",
+			__func__, mixerdevice_get_ioctls(mixer->device)
+			- ioctls, cnt, mixer->controls_cnt);
+#endif
+	mixer->ui_time += g_get_monotonic_time() - start;
+	_mixer_refreshed(mixer);
 	return ret;
 }
 
@@ -913,64 +1311,119 @@ void mixer_show_all(Mixer * mixer)
 /* mixer_show_class */
 void mixer_show_class(Mixer * mixer, String const * name)
 {
-#ifdef AUDIO_MIXER_DEVINFO
 	size_t u;
 
-	if(mixer->notebook != NULL && name != NULL)
+	if(name != NULL)
 	{
 		for(u = 0; u < mixer->classes_cnt; u++)
+			if(mixer->classes[u].hbox != NULL
+					&& mixer->classes[u].name != NULL
+					&& strcmp(mixer->classes[u].name, name)
+					== 0)
+				break;
+		/* there is no such class */
+		if(u == mixer->classes_cnt)
+			return;
+		if(mixer->notebook != NULL)
 		{
-			if(mixer->classes[u].hbox == NULL)
-				continue;
-			if(strcmp(mixer->classes[u].label.name, name) != 0)
-				continue;
 			gtk_notebook_set_current_page(GTK_NOTEBOOK(
 						mixer->notebook),
 					mixer->classes[u].page);
+			return;
 		}
-		return;
 	}
 	for(u = 0; u < mixer->classes_cnt; u++)
 		if(mixer->classes[u].hbox == NULL)
 			continue;
-		else if(name == NULL
-				|| strcmp(mixer->classes[u].label.name, name)
-				== 0)
-			gtk_widget_show(mixer->classes[u].hbox);
+		else if(name == NULL || (mixer->classes[u].name != NULL
+					&& strcmp(mixer->classes[u].name, name)
+					== 0))
+			_mixer_show_hbox(mixer, &mixer->classes[u]);
 		else
 			gtk_widget_hide(mixer->classes[u].hbox);
-#endif
 }
 
 
 /* private */
 /* functions */
 /* mixer_error */
+static MixerError * _error_get(Mixer * mixer, char const * message, int code);
 static int _error_text(char const * message, int ret);
 
 static int _mixer_error(Mixer * mixer, char const * message, int ret)
 {
-	GtkWidget * dialog;
-	char const * error;
+	int code = errno;
+	MixerError * e;
+	time_t now;
+	unsigned long count;
+#if GTK_CHECK_VERSION(2, 18, 0)
+	char buf[256];
+#endif
 
 	if(mixer == NULL)
 		return _error_text(message, ret);
-	error = strerror(errno);
-	dialog = gtk_message_dialog_new(GTK_WINDOW(mixer->window),
-			GTK_DIALOG_DESTROY_WITH_PARENT, GTK_MESSAGE_ERROR,
-			GTK_BUTTONS_CLOSE, "%s",
-#if GTK_CHECK_VERSION(2, 6, 0)
-			_("Error"));
-	gtk_message_dialog_format_secondary_text(GTK_MESSAGE_DIALOG(dialog),
-			"%s: %s", message,
+	/* never block: count the errors and report them without waiting */
+	mixer->errors_total++;
+	if((e = _error_get(mixer, message, code)) == NULL)
+	{
+		errno = code;
+		return _error_text(message, ret);
+	}
+	e->count++;
+	now = time(NULL);
+#if GTK_CHECK_VERSION(2, 18, 0)
+	if(mixer->infobar != NULL)
+	{
+		if(e->count > 1)
+			snprintf(buf, sizeof(buf), _("%s: %s (%lu times)"),
+					message, strerror(code), e->count);
+		else
+			snprintf(buf, sizeof(buf), "%s: %s", message,
+					strerror(code));
+		gtk_label_set_text(GTK_LABEL(mixer->infobar_label), buf);
+		gtk_widget_show(mixer->infobar);
+	}
 #endif
-			error);
-	gtk_window_set_title(GTK_WINDOW(dialog), _("Error"));
-	gtk_dialog_run(GTK_DIALOG(dialog));
-	gtk_widget_destroy(dialog);
+	/* rate-limit the reports on the standard error */
+	if(e->reported > 0 && now - e->time < MIXER_ERROR_INTERVAL)
+		return ret;
+	count = e->count - e->reported;
+	e->reported = e->count;
+	e->time = now;
+	if(count > 1)
+		fprintf(stderr, "%s: %s: %s (%lu times)\n", PROGNAME_MIXER,
+				message, strerror(code), count);
+	else
+		fprintf(stderr, "%s: %s: %s\n", PROGNAME_MIXER, message,
+				strerror(code));
 	return ret;
 }
 
+static MixerError * _error_get(Mixer * mixer, char const * message, int code)
+{
+	MixerError * e;
+	size_t i;
+
+	for(i = 0; i < mixer->errors_cnt; i++)
+		if(mixer->errors[i].code == code
+				&& string_compare(mixer->errors[i].message,
+					message) == 0)
+			return &mixer->errors[i];
+	if((e = realloc(mixer->errors, sizeof(*e) * (mixer->errors_cnt + 1)))
+			== NULL)
+		return NULL;
+	mixer->errors = e;
+	e = &mixer->errors[mixer->errors_cnt];
+	if((e->message = string_new(message)) == NULL)
+		return NULL;
+	mixer->errors_cnt++;
+	e->code = code;
+	e->count = 0;
+	e->reported = 0;
+	e->time = 0;
+	return e;
+}
+
 static int _error_text(char const * message, int ret)
 {
 	fputs(PROGNAME_MIXER ": ", stderr);
@@ -980,116 +1433,29 @@ static int _error_text(char const * message, int ret)
 
 
 /* accessors */
-/* mixer_get_control */
-static int _mixer_get_control(Mixer * mixer, MixerControl2 * control)
-{
-#ifdef AUDIO_MIXER_DEVINFO
-	mixer_ctrl_t p;
-	struct mixer_devinfo md;
-	int i;
-	uint16_t u16;
-# ifdef DEBUG
-	size_t u;
-	char * sep = "";
-# endif
+/* mixer_get_bind */
+static gboolean _mixer_get_bind(Mixer * mixer, MixerControl2 * control)
+{
+	uint8_t const * levels = &mixer->levels[control->level];
+	size_t i;
 
-	md.index = control->index;
-	if(ioctl(mixer->fd, AUDIO_MIXER_DEVINFO, &md) != 0)
-	{
-		if(errno == ENXIO)
-			return -errno;
-		return _mixer_error(mixer, "AUDIO_MIXER_DEVINFO", -errno);
-	}
-	p.dev = control->index;
-	/* XXX this is necessary for some drivers and I don't like it */
-	if((p.type = md.type) == AUDIO_MIXER_VALUE)
-		p.un.value.num_channels = md.un.v.num_channels;
-	if(ioctl(mixer->fd, AUDIO_MIXER_READ, &p) != 0)
-		return -_mixer_error(mixer, "AUDIO_MIXER_READ", 1);
-	control->type = p.type;
-# ifdef DEBUG
-	for(u = 0; u < mixer->classes_cnt; u++)
-		if(mixer->classes[u].mixer_class == md.mixer_class)
-			printf("%s", mixer->classes[u].label.name);
-	printf(".%s=", md.label.name);
-# endif
-	switch(p.type)
-	{
-		case AUDIO_MIXER_ENUM:
-			control->un.ord = p.un.ord;
-# ifdef DEBUG
-			for(i = 0; i < md.un.e.num_mem; i++)
-			{
-				if(md.un.e.member[i].ord != p.un.ord)
-					continue;
-				printf("%s%s", sep,
-						md.un.e.member[i].label.name);
-				break;
-			}
-# endif
-			break;
-		case AUDIO_MIXER_SET:
-			control->un.mask = p.un.mask;
-# ifdef DEBUG
-			for(i = 0; i < md.un.s.num_mem; i++)
-			{
-				if((p.un.mask & (1 << i)) == 0)
-					continue;
-				printf("%s%s", sep,
-						md.un.s.member[i].label.name);
-				sep = ",";
-			}
-			printf("%s", "  {");
-			for(i = 0; i < md.un.s.num_mem; i++)
-				printf(" %s", md.un.s.member[i].label.name);
-			printf("%s", " }");
-# endif
-			break;
-		case AUDIO_MIXER_VALUE:
-			u16 = md.un.v.delta;
-			if((u16 = ceil((u16 * 100) / 255.0)) == 0)
-				u16 = 1;
-			control->un.level.delta = u16;
-			control->un.level.channels_cnt
-				= p.un.value.num_channels;
-			for(i = 0; i < p.un.value.num_channels; i++)
-			{
-# ifdef DEBUG
-				printf("%s%u", sep, p.un.value.level[i]);
-				sep = ",";
-# endif
-				u16 = p.un.value.level[i];
-				u16 = ceil((u16 * 100) / 255.0);
-				control->un.level.channels[i] = u16;
-			}
-#ifdef DEBUG
-			printf(" delta=%u", md.un.v.delta);
-#endif
-			break;
-	}
-# ifdef DEBUG
-	putchar('\n');
-# endif
-#else
-	int value;
-	uint16_t u16;
-
-	if(ioctl(mixer->fd, MIXER_READ(control->index), &value) != 0)
-		return _mixer_error(NULL, "MIXER_READ", -errno);
-	control->type = 0;
-	control->un.level.delta = 1;
-	control->un.level.channels_cnt = 2;
-	u16 = value & 0xff;
-	control->un.level.channels[0] = u16;
-	u16 = (value & 0xff00) >> 8;
-	control->un.level.channels[1] = u16;
-# ifdef DEBUG
-	fprintf(stderr, "DEBUG: %s() % 3d % 3d\n", __func__,
-			control->un.level.channels[0],
-			control->un.level.channels[1]);
-# endif
-#endif
-	return 0;
+	for(i = 1; i < control->channels_cnt; i++)
+		if(levels[i] != levels[0])
+			return FALSE;
+	return TRUE;
+}
+
+
+/* mixer_get_control2 */
+static MixerControl2 * _mixer_get_control2(Mixer * mixer,
+		MixerControl * control)
+{
+	size_t i;
+
+	if((i = mixercontrol_get_index(control)) >= mixer->controls_cnt
+			|| mixer->controls[i].control != control)
+		return NULL;
+	return &mixer->controls[i];
 }
 
 
@@ -1131,126 +1497,555 @@ static String const * _mixer_get_icon(String const * id)
 }
 
 
-/* mixer_set_control */
-static int _mixer_set_control(Mixer * mixer, MixerControl2 * control)
+/* mixer_get_value */
+static void _mixer_get_value(Mixer * mixer, MixerControl2 * control,
+		MixerValue * value)
 {
-#ifdef AUDIO_MIXER_DEVINFO
-	mixer_ctrl_t p;
-	int i;
+	if(control->type != MDT_VALUE)
+	{
+		value->ord = control->value;
+		return;
+	}
+	value->level.channels_cnt = control->channels_cnt;
+	value->level.delta = control->delta;
+	memcpy(value->level.channels, &mixer->levels[control->level],
+			control->channels_cnt);
+}
 
-	p.dev = control->index;
-	p.type = control->type;
-	p.un.value.num_channels = control->un.level.channels_cnt;
-	for(i = 0; i < p.un.value.num_channels; i++)
-		p.un.value.level[i] = control->un.level.channels[i];
-	if(ioctl(mixer->fd, AUDIO_MIXER_WRITE, &p) != 0)
-		return -_mixer_error(mixer, "AUDIO_MIXER_WRITE", 1);
-#else
-	int level;
-
-	level = (control->un.level.channels[1] << 8)
-		| control->un.level.channels[0];
-# ifdef DEBUG
-	fprintf(stderr, "DEBUG: %s() level=0x%04x\n", __func__, level);
-# endif
-	if(ioctl(mixer->fd, MIXER_WRITE(control->index), &level) != 0)
-		return -_mixer_error(mixer, "MIXER_WRITE", 1);
-#endif
-	return 0;
+
+/* mixer_get_visible */
+static gboolean _mixer_get_visible(Mixer * mixer, MixerControl2 * control)
+{
+	MixerClass * p = &mixer->classes[control->mclass];
+
+	if(mixer->notebook != NULL)
+		return (p->page == gtk_notebook_get_current_page(GTK_NOTEBOOK(
+						mixer->notebook))) ? TRUE : FALSE;
+	return gtk_widget_get_visible(p->hbox);
 }
 
 
 /* mixer_set_control_widget */
-static int _set_control_widget_channels(MixerControl2 * control);
-static int _set_control_widget_mute(MixerControl2 * control);
-static int _set_control_widget_radio(MixerControl2 * control);
-static int _set_control_widget_set(MixerControl2 * control);
-
 static int _mixer_set_control_widget(Mixer * mixer, MixerControl2 * control)
 {
-	String const * type;
-	(void) mixer;
-
-	if((type = mixercontrol_get_type(control->control)) == NULL)
-		/* XXX report error */
-		return -1;
-	if(string_compare(type, "channels") == 0)
-		return _set_control_widget_channels(control);
-	if(string_compare(type, "mute") == 0)
-		return _set_control_widget_mute(control);
-	if(string_compare(type, "radio") == 0)
-		return _set_control_widget_radio(control);
-	if(string_compare(type, "set") == 0)
-		return _set_control_widget_set(control);
-	return -1;
+	return _mixer_kinds[control->kind].set_widget(mixer, control);
 }
 
-static int _set_control_widget_channels(MixerControl2 * control)
+static int _set_control_widget_channels(Mixer * mixer, MixerControl2 * control)
 {
 	gboolean bind = TRUE;
-	gdouble value;
+	uint8_t const * levels = &mixer->levels[control->level];
 	size_t i;
-	char buf[16];
 
 	/* unset bind if the channels are no longer synchronized */
-	for(i = 1; i < control->un.level.channels_cnt; i++)
-		if(control->un.level.channels[i]
-				!= control->un.level.channels[i - 1])
+	for(i = 1; i < control->channels_cnt; i++)
+		if(levels[i] != levels[i - 1])
 		{
 			bind = FALSE;
 			break;
 		}
 	if(bind == FALSE)
-		if(mixercontrol_set(control->control, "bind", FALSE, NULL) != 0)
+		if(mixercontrol_set_property(control->control, MCP_BIND, FALSE)
+				!= 0)
 			return -1;
 	/* set the individual channels */
-	for(i = 0; i < control->un.level.channels_cnt; i++)
+	return mixercontrol_set_levels(control->control, levels,
+			control->channels_cnt);
+}
+
+static int _set_control_widget_mute(Mixer * mixer, MixerControl2 * control)
+{
+	(void) mixer;
+	(void) control;
+
+	/* FIXME implement */
+	return -1;
+}
+
+static int _set_control_widget_radio(Mixer * mixer, MixerControl2 * control)
+{
+	(void) mixer;
+
+	return mixercontrol_set_property(control->control, MCP_VALUE,
+			control->value);
+}
+
+static int _set_control_widget_set(Mixer * mixer, MixerControl2 * control)
+{
+	(void) mixer;
+
+	return mixercontrol_set_property(control->control, MCP_VALUE,
+			control->value);
+}
+
+
+/* mixer_set_value */
+static void _mixer_set_value(Mixer * mixer, MixerControl2 * control,
+		MixerValue const * value)
+{
+	if(control->type != MDT_VALUE)
+	{
+		control->value = value->ord;
+		return;
+	}
+	/* the device may report fewer channels than announced */
+	memcpy(&mixer->levels[control->level], value->level.channels,
+			MIN(control->channels_cnt,
+				value->level.channels_cnt));
+}
+
+
+/* useful */
+/* mixer_compare_control */
+static int _mixer_compare_control(Mixer * mixer, MixerControl2 * control)
+{
+	switch(control->type)
 	{
-		snprintf(buf, sizeof(buf), "value%zu", i);
-		value = control->un.level.channels[i];
-		if(mixercontrol_set(control->control, buf, value, NULL) != 0)
+		case MDT_ENUM:
+		case MDT_SET:
+			return control->value - control->shadow;
+		case MDT_VALUE:
+			return memcmp(&mixer->levels[control->level],
+					&mixer->shadows[control->level],
+					control->channels_cnt);
+		default:
 			return -1;
 	}
+}
+
+
+/* mixer_flush */
+static int _mixer_flush(Mixer * mixer)
+{
+	int ret = 0;
+	int res;
+	size_t i;
+	MixerControl2 * mc;
+
+	for(i = 0; i < mixer->pending_cnt; i++)
+	{
+		mc = &mixer->controls[mixer->pending[i]];
+		/* keep the remaining writes if the thread is busy */
+		if((res = _mixer_kinds[mc->kind].set(mixer, mc)) == -EAGAIN)
+			break;
+		ret |= res;
+		mc->pending = FALSE;
+	}
+	if(mixer->thread != NULL && i > 0)
+		_mixer_notify(mixer->thread->wake[1]);
+	memmove(mixer->pending, &mixer->pending[i], sizeof(*mixer->pending)
+			* (mixer->pending_cnt - i));
+	if((mixer->pending_cnt -= i) > 0 && mixer->pending_source == 0)
+		mixer->pending_source = g_timeout_add(MAX(mixer->write_interval,
+					1), _set_on_flush, mixer);
+	return ret;
+}
+
+
+/* mixer_invalidate_control */
+static void _invalidate_control_apply(Mixer * mixer);
+/* callbacks */
+#if GTK_CHECK_VERSION(3, 8, 0)
+static gboolean _invalidate_control_on_tick(GtkWidget * widget,
+		GdkFrameClock * clock, gpointer data);
+#else
+static gboolean _invalidate_control_on_idle(gpointer data);
+#endif
+
+static int _mixer_invalidate_control(Mixer * mixer, MixerControl2 * control)
+{
+	size_t * p;
+
+	if(control->dirty)
+		return 0;
+	if((p = realloc(mixer->dirty, sizeof(*p) * (mixer->dirty_cnt + 1)))
+			== NULL)
+		return -_mixer_error(mixer, "realloc", 1);
+	mixer->dirty = p;
+	mixer->dirty[mixer->dirty_cnt++] = control - mixer->controls;
+	control->dirty = TRUE;
+	if(mixer->frame_source != 0)
+		return 0;
+	/* the widgets are all updated before the next layout */
+	mixer->dirty_time = g_get_monotonic_time();
+#if GTK_CHECK_VERSION(3, 8, 0)
+	mixer->frame_source = gtk_widget_add_tick_callback(mixer->widget,
+			_invalidate_control_on_tick, mixer, NULL);
+#else
+	mixer->frame_source = g_idle_add_full(G_PRIORITY_HIGH_IDLE,
+			_invalidate_control_on_idle, mixer, NULL);
+#endif
 	return 0;
 }
 
-static int _set_control_widget_mute(MixerControl2 * control)
+static void _invalidate_control_apply(Mixer * mixer)
 {
-	/* FIXME implement */
-	return -1;
+	gint64 start;
+	size_t i;
+	MixerControl2 * mc;
+
+	start = g_get_monotonic_time();
+	for(i = 0; i < mixer->dirty_cnt; i++)
+	{
+		mc = &mixer->controls[mixer->dirty[i]];
+		mc->dirty = FALSE;
+		/* the widget may have been changed by the user meanwhile */
+		if(mc->pending || _mixer_compare_control(mixer, mc) == 0)
+			continue;
+		if(_mixer_set_control_widget(mixer, mc) == 0)
+			_mixer_shadow_control(mixer, mc);
+	}
+	mixer->dirty_cnt = 0;
+	mixer->frame_source = 0;
+	mixer->frames++;
+	mixer->ui_time += g_get_monotonic_time() - start;
 }
 
-static int _set_control_widget_radio(MixerControl2 * control)
+/* callbacks */
+#if GTK_CHECK_VERSION(3, 8, 0)
+static gboolean _invalidate_control_on_tick(GtkWidget * widget,
+		GdkFrameClock * clock, gpointer data)
+{
+	Mixer * mixer = data;
+	gint64 time;
+	gint64 interval;
+	(void) widget;
+
+	/* count the updates applied later than the next frame, once */
+	time = gdk_frame_clock_get_frame_time(clock);
+	gdk_frame_clock_get_refresh_info(clock, time, &interval, NULL);
+	if(interval > 0 && time - mixer->dirty_time > interval)
+		mixer->frames_dropped++;
+	_invalidate_control_apply(mixer);
+	return FALSE;
+}
+#else
+static gboolean _invalidate_control_on_idle(gpointer data)
 {
-	return mixercontrol_set(control->control, "value", control->un.mask,
-			NULL);
+	Mixer * mixer = data;
+
+	_invalidate_control_apply(mixer);
+	return FALSE;
 }
+#endif
+
 
-static int _set_control_widget_set(MixerControl2 * control)
+/* mixer_load_class */
+static int _mixer_load_class(Mixer * mixer, MixerClass * p)
 {
-	return mixercontrol_set(control->control, "value", control->un.mask,
-				NULL);
+	size_t cnt;
+	size_t i;
+	size_t u;
+	MixerDeviceInfo const * md;
+	MixerDeviceInfo const * md2;
+	MixerControl2 * q;
+	MixerControl * control;
+	String const * title;
+	GtkWidget * widget;
+	GtkWidget * vbox2;
+	size_t levels_cnt;
+
+	if(p->loaded || p->hbox == NULL)
+		return 0;
+	p->loaded = TRUE;
+	cnt = mixerdevice_get_count(mixer->device);
+	for(i = 0; i < cnt; i++)
+	{
+		md = mixerdevice_get_info(mixer->device, i);
+		if(md->type == MDT_CLASS || md->mixer_class != p->mixer_class)
+			continue;
+		if((q = realloc(mixer->controls, sizeof(*q)
+						* (mixer->controls_cnt + 1)))
+				== NULL)
+		{
+			_mixer_error(mixer, "realloc", 1);
+			continue;
+		}
+		mixer->controls = q;
+		q = &mixer->controls[mixer->controls_cnt];
+		q->index = i;
+		q->mclass = p - mixer->classes;
+		q->type = md->type;
+		q->fresh = (mixer->thread != NULL) ? TRUE : FALSE;
+		q->stale = FALSE;
+		q->pending = FALSE;
+		q->dirty = FALSE;
+		q->serial = 0;
+		title = (md->label[0] != '\0') ? md->label : md->name;
+		control = NULL;
+		levels_cnt = mixer->levels_cnt;
+		switch(md->type)
+		{
+			case MDT_ENUM:
+				control = _new_enum(mixer, q, md, md->name,
+						_mixer_get_icon(md->name),
+						title);
+				break;
+			case MDT_SET:
+				control = _new_set(mixer, q, md, md->name,
+						_mixer_get_icon(md->name),
+						title);
+				break;
+			case MDT_VALUE:
+				control = _new_value(mixer, q, md, md->name,
+						_mixer_get_icon(md->name),
+						title);
+				break;
+			default:
+				break;
+		}
+		if(control == NULL)
+		{
+			/* reclaim the levels */
+			mixer->levels_cnt = levels_cnt;
+			continue;
+		}
+		mixercontrol_set_index(control, mixer->controls_cnt++);
+		/* let the thread report the current state */
+		if(mixer->thread != NULL)
+			_mixer_read_later(mixer, q);
+		widget = mixercontrol_get_widget(control);
+		/* the meters have a width of their own */
+		if(_mixer_meters && md->type == MDT_VALUE)
+			gtk_box_pack_start(GTK_BOX(p->hbox), widget, FALSE,
+					TRUE, 0);
+		else
+		{
+			vbox2 = gtk_box_new(GTK_ORIENTATION_VERTICAL, 4);
+			gtk_box_pack_start(GTK_BOX(vbox2), widget, TRUE, TRUE,
+					0);
+			gtk_size_group_add_widget(mixer->hgroup, widget);
+			gtk_box_pack_start(GTK_BOX(p->hbox), vbox2, FALSE, TRUE,
+					0);
+		}
+		/* add a mute button if relevant */
+		if(md->type != MDT_VALUE)
+			continue;
+		if(i + 1 >= cnt)
+			break;
+		md2 = mixerdevice_get_info(mixer->device, i + 1);
+		u = strlen(md->name);
+		if(md2->type != MDT_ENUM || strncmp(md->name, md2->name, u) != 0
+				|| (u = strlen(md2->name)) < 6
+				|| strcmp(&md2->name[u - 5], ".mute") != 0)
+			continue;
+		/* XXX may fail */
+		mixercontrol_set(control, "show-mute", TRUE, NULL);
+		i++;
+	}
+	if(mixer->thread != NULL)
+		_mixer_post_reads(mixer);
+	if(mixer->notebook != NULL)
+		gtk_widget_show_all(p->hbox);
+	return 0;
 }
 
 
-/* useful */
-/* mixer_refresh_control */
-static int _mixer_refresh_control(Mixer * mixer, MixerControl2 * control)
+/* mixer_notify */
+static void _mixer_notify(int fd)
 {
-	int ret;
+	/* the reader is already due to wake up if the pipe is full */
+	while(write(fd, "", 1) < 0 && errno == EINTR);
+}
 
-	if((ret = _mixer_get_control(mixer, control)) != 0)
+
+/* mixer_post */
+static int _mixer_post(Mixer * mixer, MixerMessage * message)
+{
+	/* the caller notifies the thread once done posting */
+	if(_mixer_queue_push(&mixer->thread->commands, message) != 0)
+		return -EAGAIN;
+	return 0;
+}
+
+
+/* mixer_post_reads */
+static void _mixer_post_reads(Mixer * mixer)
+{
+	size_t reads = 0;
+	MixerControl2 * mc;
+
+	for(; mixer->refresh_next < mixer->controls_cnt; mixer->refresh_next++)
 	{
-		if(ret == -ENXIO)
-			mixercontrol_disable(control->control);
-		return ret;
+		mc = &mixer->controls[mixer->refresh_next];
+		if(mc->stale == FALSE)
+			continue;
+		/* resume from this control once results come in */
+		if(_mixer_read_control(mixer, mc) != 0)
+			break;
+		mc->stale = FALSE;
+		reads++;
 	}
-	if((ret = _mixer_set_control_widget(mixer, control)) == 0)
-		mixercontrol_enable(control->control);
+	if(reads > 0)
+		_mixer_notify(mixer->thread->wake[1]);
+	if(mixer->refresh_next < mixer->controls_cnt)
+		return;
+	mixer->refresh_next = SIZE_MAX;
+	/* the refresh completes with the last read */
+	if(mixer->refresh_posting == FALSE)
+		return;
+	mixer->refresh_posting = FALSE;
+	if(--mixer->refreshing == 0)
+		_mixer_refreshed(mixer);
+}
+
+
+/* mixer_queue_full */
+static int _mixer_queue_full(MixerQueue * queue)
+{
+	guint head = g_atomic_int_get(&queue->head);
+	guint tail = g_atomic_int_get(&queue->tail);
+
+	return (tail - head >= MIXER_QUEUE_SIZE) ? 1 : 0;
+}
+
+
+/* mixer_queue_pop */
+static int _mixer_queue_pop(MixerQueue * queue, MixerMessage * message)
+{
+	guint head = g_atomic_int_get(&queue->head);
+
+	/* only the consumer moves the head */
+	if(head == (guint)g_atomic_int_get(&queue->tail))
+		return -1;
+	*message = queue->messages[head % MIXER_QUEUE_SIZE];
+	g_atomic_int_set(&queue->head, head + 1);
+	return 0;
+}
+
+
+/* mixer_queue_push */
+static int _mixer_queue_push(MixerQueue * queue, MixerMessage const * message)
+{
+	guint tail = g_atomic_int_get(&queue->tail);
+
+	/* only the producer moves the tail */
+	if(tail - (guint)g_atomic_int_get(&queue->head) >= MIXER_QUEUE_SIZE)
+		return -1;
+	queue->messages[tail % MIXER_QUEUE_SIZE] = *message;
+	g_atomic_int_set(&queue->tail, tail + 1);
+	return 0;
+}
+
+
+/* mixer_read_control */
+static int _mixer_read_control(Mixer * mixer, MixerControl2 * control)
+{
+	MixerMessage message;
+
+	message.type = MMT_READ;
+	message.position = control - mixer->controls;
+	message.serial = control->serial;
+	message.index = control->index;
+	if(_mixer_post(mixer, &message) != 0)
+		return -EAGAIN;
+	mixer->refreshing++;
+	return 0;
+}
+
+
+/* mixer_read_later */
+static void _mixer_read_later(Mixer * mixer, MixerControl2 * control)
+{
+	size_t position = control - mixer->controls;
+
+	/* the reads are posted in order as the commands drain */
+	control->stale = TRUE;
+	if(position < mixer->refresh_next)
+		mixer->refresh_next = position;
+}
+
+
+/* mixer_refresh_class */
+static int _mixer_refresh_class(Mixer * mixer, MixerClass * p)
+{
+	int ret = 0;
+	size_t i;
+	MixerControl2 * mc;
+
+	for(i = 0; i < mixer->controls_cnt; i++)
+	{
+		mc = &mixer->controls[i];
+		if(mc->pending || &mixer->classes[mc->mclass] != p)
+			continue;
+		if(mixer->thread == NULL)
+			ret |= _mixer_refresh_control(mixer, mc);
+		else
+			_mixer_read_later(mixer, mc);
+	}
+	if(mixer->thread != NULL)
+		_mixer_post_reads(mixer);
 	return ret;
 }
 
 
+/* mixer_refresh_control */
+static int _mixer_refresh_control(Mixer * mixer, MixerControl2 * control)
+{
+	int ret;
+	char const * error = NULL;
+	MixerValue value;
+
+	mixer->reads++;
+	if((ret = mixerdevice_get_value(mixer->device, control->index, &value,
+					&error)) == 0)
+		_mixer_set_value(mixer, control, &value);
+	return _mixer_update_control(mixer, control, ret, error);
+}
+
+
+/* mixer_refreshed */
+static void _mixer_refreshed(Mixer * mixer)
+{
+	unsigned int interval;
+
+	mixer->refreshes++;
+	if(mixer->refresh_scheduled == FALSE)
+		return;
+	mixer->refresh_scheduled = FALSE;
+	/* back off exponentially while nothing changes */
+	interval = mixer->refresh_changed ? MIXER_REFRESH_FAST
+		: MIN(mixer->refresh_interval * 2, MIXER_REFRESH_SLOW);
+	mixer->refresh_changed = FALSE;
+	_mixer_schedule_refresh(mixer, interval);
+}
+
+
+/* mixer_schedule_refresh */
+/* callbacks */
+static gboolean _schedule_refresh_on_timeout(gpointer data);
+
+static void _mixer_schedule_refresh(Mixer * mixer, unsigned int interval)
+{
+	/* stop refreshing altogether while not visible */
+	if(mixer->mapped == FALSE || mixer->iconified || mixer->obscured)
+		interval = 0;
+	if(interval == mixer->refresh_interval)
+		return;
+#ifdef DEBUG
+	fprintf(stderr, "DEBUG: %s(%u)\n", __func__, interval);
+#endif
+	if(mixer->source != 0)
+		g_source_remove(mixer->source);
+	mixer->source = (interval > 0) ? g_timeout_add(interval,
+			_schedule_refresh_on_timeout, mixer) : 0;
+	mixer->refresh_interval = interval;
+}
+
+/* callbacks */
+static gboolean _schedule_refresh_on_timeout(gpointer data)
+{
+	Mixer * mixer = data;
+	guint source = mixer->source;
+
+	/* the interval is adapted once the refresh completes */
+	mixer->refresh_scheduled = TRUE;
+	mixer_refresh(mixer);
+	/* this source was removed if rescheduled meanwhile */
+	return (mixer->source == source) ? TRUE : FALSE;
+}
+
+
 /* mixer_scrolled_window_add */
 static void _mixer_scrolled_window_add(GtkWidget * window, GtkWidget * widget)
 {
@@ -1263,17 +2058,37 @@ static void _mixer_scrolled_window_add(GtkWidget * window, GtkWidget * widget)
 }
 
 
+/* mixer_shadow_control */
+static void _mixer_shadow_control(Mixer * mixer, MixerControl2 * control)
+{
+	control->shadow = control->value;
+	memcpy(&mixer->shadows[control->level], &mixer->levels[control->level],
+			control->channels_cnt);
+}
+
+
+/* mixer_show_hbox */
+static void _mixer_show_hbox(Mixer * mixer, MixerClass * p)
+{
+	if(gtk_widget_get_visible(p->hbox))
+		return;
+	gtk_widget_show(p->hbox);
+	/* the controls were not refreshed while hidden */
+	if(mixer->mapped)
+		_mixer_refresh_class(mixer, p);
+}
+
+
 /* mixer_show_view */
 static void _mixer_show_view(Mixer * mixer, int view)
 {
-#ifdef AUDIO_MIXER_DEVINFO
 	size_t u;
 
 	if(view < 0)
 	{
 		for(u = 0; u < mixer->classes_cnt; u++)
 			if(mixer->classes[u].hbox != NULL)
-				gtk_widget_show(mixer->classes[u].hbox);
+				_mixer_show_hbox(mixer, &mixer->classes[u]);
 		return;
 	}
 	u = view;
@@ -1283,8 +2098,312 @@ static void _mixer_show_view(Mixer * mixer, int view)
 		if(mixer->classes[u].hbox == NULL)
 			continue;
 		else if(u == (size_t)view)
-			gtk_widget_show(mixer->classes[u].hbox);
+			_mixer_show_hbox(mixer, &mixer->classes[u]);
 		else
 			gtk_widget_hide(mixer->classes[u].hbox);
+}
+
+
+/* mixer_start_thread */
+static gpointer _start_thread_run(gpointer data);
+static void _start_thread_process(Mixer * mixer, MixerMessage * message);
+static void _start_thread_result(Mixer * mixer, MixerMessage * message);
+/* callbacks */
+static gboolean _start_thread_on_notify(GIOChannel * source,
+		GIOCondition condition, gpointer data);
+
+static int _mixer_start_thread(Mixer * mixer)
+{
+	MixerThread * thread;
+
+	if((thread = malloc(sizeof(*thread))) == NULL)
+		return -1;
+	thread->thread = NULL;
+	thread->quit = 0;
+	thread->commands.head = 0;
+	thread->commands.tail = 0;
+	thread->wake[0] = -1;
+	thread->wake[1] = -1;
+	thread->results.head = 0;
+	thread->results.tail = 0;
+	thread->notify[0] = -1;
+	thread->notify[1] = -1;
+	thread->stalled = 0;
+	thread->channel = NULL;
+	thread->source = 0;
+	mixer->thread = thread;
+	if(pipe(thread->wake) != 0 || pipe(thread->notify) != 0
+			|| fcntl(thread->wake[1], F_SETFL, O_NONBLOCK) != 0
+			|| fcntl(thread->notify[0], F_SETFL, O_NONBLOCK) != 0
+			|| fcntl(thread->notify[1], F_SETFL, O_NONBLOCK) != 0)
+	{
+		_mixer_stop_thread(mixer);
+		return -1;
+	}
+	thread->channel = g_io_channel_unix_new(thread->notify[0]);
+	thread->source = g_io_add_watch(thread->channel, G_IO_IN,
+			_start_thread_on_notify, mixer);
+#if GLIB_CHECK_VERSION(2, 32, 0)
+	thread->thread = g_thread_try_new(PROGNAME_MIXER, _start_thread_run,
+			mixer, NULL);
+#else
+	if(g_thread_supported())
+		thread->thread = g_thread_create(_start_thread_run, mixer, TRUE,
+				NULL);
 #endif
+	if(thread->thread == NULL)
+	{
+		_mixer_stop_thread(mixer);
+		return -1;
+	}
+	return 0;
+}
+
+static gpointer _start_thread_run(gpointer data)
+{
+	Mixer * mixer = data;
+	MixerThread * thread = mixer->thread;
+	MixerMessage message;
+	size_t cnt;
+	char buf[32];
+	ssize_t len;
+
+	for(;;)
+	{
+		for(cnt = 0;; cnt++)
+		{
+			/* wait for room for the results unless quitting */
+			if(g_atomic_int_get(&thread->quit) == 0
+					&& _mixer_queue_full(&thread->results))
+			{
+				g_atomic_int_set(&thread->stalled, 1);
+				if(_mixer_queue_full(&thread->results))
+					break;
+				g_atomic_int_set(&thread->stalled, 0);
+			}
+			if(_mixer_queue_pop(&thread->commands, &message) != 0)
+				break;
+			_start_thread_process(mixer, &message);
+			_mixer_queue_push(&thread->results, &message);
+		}
+		if(cnt > 0)
+			_mixer_notify(thread->notify[1]);
+		if(g_atomic_int_get(&thread->quit) != 0)
+			break;
+		while((len = read(thread->wake[0], buf, sizeof(buf))) < 0
+				&& errno == EINTR);
+		if(len <= 0)
+			break;
+	}
+	return NULL;
+}
+
+static void _start_thread_process(Mixer * mixer, MixerMessage * message)
+{
+	/* XXX no widget may be accessed from here */
+	message->error = NULL;
+	switch(message->type)
+	{
+		case MMT_READ:
+			/* skip the controls known to be unchanged */
+			if(mixerdevice_get_changed(mixer->device,
+						message->index) == 0)
+			{
+				message->ret = 1;
+				break;
+			}
+			message->ret = mixerdevice_get_value(mixer->device,
+					message->index, &message->value,
+					&message->error);
+			break;
+		case MMT_REFRESH:
+			message->ret = mixerdevice_get_modified(mixer->device);
+			break;
+		case MMT_WRITE:
+			message->ret = mixerdevice_set_value(mixer->device,
+					message->index, &message->value,
+					&message->error);
+			break;
+	}
+}
+
+static void _start_thread_result(Mixer * mixer, MixerMessage * message)
+{
+	MixerControl2 * mc;
+	size_t i;
+
+	switch(message->type)
+	{
+		case MMT_READ:
+			mixer->refreshing--;
+			/* the controls left unchanged were not read */
+			if(message->ret <= 0)
+				mixer->reads++;
+			mc = &mixer->controls[message->position];
+			/* the widget may be ahead of the hardware by now */
+			if(message->ret > 0 || mc->pending
+					|| mc->serial != message->serial)
+				break;
+			if(message->ret == 0)
+				_mixer_set_value(mixer, mc, &message->value);
+			/* the channels may not have been balanced */
+			if(message->ret == 0 && mc->fresh)
+			{
+				mc->fresh = FALSE;
+				if(mc->type == MDT_VALUE)
+					mixercontrol_set_property(mc->control,
+							MCP_BIND,
+							_mixer_get_bind(mixer,
+								mc));
+			}
+			_mixer_update_control(mixer, mc, message->ret,
+					message->error);
+			break;
+		case MMT_REFRESH:
+			if(message->ret == 0)
+			{
+				mixer->refreshing--;
+				break;
+			}
+			for(i = 0; i < mixer->controls_cnt; i++)
+				if(mixer->controls[i].pending == FALSE
+						&& _mixer_get_visible(mixer,
+							&mixer->controls[i]))
+					_mixer_read_later(mixer,
+							&mixer->controls[i]);
+			mixer->refresh_posting = TRUE;
+			break;
+		case MMT_WRITE:
+			if(message->ret == 0)
+				break;
+			errno = -message->ret;
+			_mixer_error(mixer, message->error, 1);
+			break;
+	}
+	if(message->type != MMT_WRITE && mixer->refreshing == 0)
+		_mixer_refreshed(mixer);
+}
+
+/* callbacks */
+static gboolean _start_thread_on_notify(GIOChannel * source,
+		GIOCondition condition, gpointer data)
+{
+	Mixer * mixer = data;
+	MixerThread * thread = mixer->thread;
+	MixerMessage message;
+	char buf[32];
+	gint64 start;
+	(void) source;
+	(void) condition;
+
+	start = g_get_monotonic_time();
+	while(read(thread->notify[0], buf, sizeof(buf)) > 0);
+	while(_mixer_queue_pop(&thread->results, &message) == 0)
+		_start_thread_result(mixer, &message);
+	if(mixer->refresh_next != SIZE_MAX || mixer->refresh_posting)
+		_mixer_post_reads(mixer);
+	mixer->ui_time += g_get_monotonic_time() - start;
+	/* the thread waits for room in the results */
+	if(g_atomic_int_get(&thread->stalled) != 0)
+	{
+		g_atomic_int_set(&thread->stalled, 0);
+		_mixer_notify(thread->wake[1]);
+	}
+	return TRUE;
+}
+
+
+/* mixer_stop_thread */
+static void _mixer_stop_thread(Mixer * mixer)
+{
+	MixerThread * thread = mixer->thread;
+	size_t i;
+
+	if(thread->thread != NULL)
+	{
+		/* the pending commands are processed first */
+		g_atomic_int_set(&thread->quit, 1);
+		_mixer_notify(thread->wake[1]);
+		g_thread_join(thread->thread);
+	}
+	if(thread->source > 0)
+		g_source_remove(thread->source);
+	if(thread->channel != NULL)
+		g_io_channel_unref(thread->channel);
+	for(i = 0; i < 2; i++)
+	{
+		if(thread->wake[i] >= 0)
+			close(thread->wake[i]);
+		if(thread->notify[i] >= 0)
+			close(thread->notify[i]);
+	}
+	free(thread);
+	mixer->thread = NULL;
+}
+
+
+/* mixer_update_control */
+static int _mixer_update_control(Mixer * mixer, MixerControl2 * control,
+		int ret, char const * error)
+{
+	if(ret != 0)
+	{
+		if(ret != -ENXIO)
+		{
+			errno = -ret;
+			return -_mixer_error(mixer, error, 1);
+		}
+		if(control->sensitive)
+		{
+			mixercontrol_disable(control->control);
+			control->sensitive = FALSE;
+		}
+		return ret;
+	}
+	/* only update the widget if the state actually changed */
+	if(_mixer_compare_control(mixer, control) != 0)
+	{
+		mixer->refresh_changed = TRUE;
+		if((ret = _mixer_invalidate_control(mixer, control)) != 0)
+			return ret;
+	}
+	if(control->sensitive == FALSE)
+	{
+		mixercontrol_enable(control->control);
+		control->sensitive = TRUE;
+	}
+	return 0;
+}
+
+
+/* mixer_write_control */
+static int _mixer_write_control(Mixer * mixer, MixerControl2 * control)
+{
+	int ret;
+	char const * error = NULL;
+	MixerMessage message;
+
+	/* the reads in progress are outdated, and binding set by now */
+	control->serial++;
+	control->fresh = FALSE;
+	if(mixer->thread != NULL)
+	{
+		message.type = MMT_WRITE;
+		message.position = control - mixer->controls;
+		message.serial = control->serial;
+		message.index = control->index;
+		_mixer_get_value(mixer, control, &message.value);
+		if((ret = _mixer_post(mixer, &message)) == 0)
+			mixer->writes++;
+		return ret;
+	}
+	_mixer_get_value(mixer, control, &message.value);
+	if((ret = mixerdevice_set_value(mixer->device, control->index,
+					&message.value, &error)) != 0)
+	{
+		errno = -ret;
+		return -_mixer_error(mixer, error, 1);
+	}
+	mixer->writes++;
+	return 0;
 }
@@ -35,6 +35,7 @@
 # include <System/string.h>
 # include "control.h"
 # include "common.h"
+# include "device.h"
 
 
 /* Mixer */
@@ -46,12 +47,22 @@ typedef enum _MixerLayout
 	ML_VERTICAL
 } MixerLayout;
 
-typedef struct _MixerProperties
+typedef struct _MixerStats
 {
-	char name[32];
-	char version[16];
-	char device[16];
-} MixerProperties;
+	unsigned long errors;
+	unsigned long frames;
+	/* frames applied later than the one following their update */
+	unsigned long frames_dropped;
+	unsigned long ioctls;
+	unsigned long plugins;
+	/* controls read from the device */
+	unsigned long reads;
+	unsigned long refreshes;
+	/* time spent in the main loop, in microseconds */
+	unsigned long ui_time;
+	unsigned long writes;
+	unsigned long writes_coalesced;
+} MixerStats;
 
 
 /* functions */
@@ -60,12 +71,19 @@ Mixer * mixer_new(GtkWidget * window, String const * device,
 void mixer_delete(Mixer * mixer);
 
 /* accessors */
+MixerControl * mixer_get_control(Mixer * mixer, String const * id);
 int mixer_get_properties(Mixer * mixer, MixerProperties * properties);
+unsigned int mixer_get_refresh_interval(Mixer * mixer);
+void mixer_get_stats(Mixer * mixer, MixerStats * stats);
 GtkWidget * mixer_get_widget(Mixer * mixer);
 
 int mixer_set(Mixer * mixer, MixerControl * control);
+/* applies to the mixers created next */
+void mixer_set_meters(gboolean meters);
+void mixer_set_write_interval(Mixer * mixer, unsigned int interval);
 
 /* useful */
+void mixer_print_stats(Mixer * mixer, FILE * fp);
 void mixer_properties(Mixer * mixer);
 
 int mixer_refresh(Mixer * mixer);
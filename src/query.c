@@ -0,0 +1,258 @@
+/* $Id$ */
+/* Copyright (c) 2020 Pierre Pronchery <khorben@defora.org> */
+/* This file is part of DeforaOS Desktop Mixer */
+/* All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include "common.h"
+#include "device.h"
+#include "query.h"
+
+
+/* MixerQuery */
+/* public */
+/* functions */
+/* mixerquery */
+static int _query_control(char const * progname, MixerDevice * device,
+		char const * query);
+static int _query_error(char const * progname, char const * message,
+		int ret);
+static int _query_parse(MixerDeviceInfo const * info, char const * string,
+		MixerValue * value);
+static void _query_print(char const * name, MixerDeviceInfo const * info,
+		MixerValue const * value);
+
+int mixerquery(char const * progname, int argc, char * argv[])
+{
+	int ret = 0;
+	int o;
+	char const * device = MIXER_DEFAULT_DEVICE;
+	char const ** queries;
+	size_t queries_cnt = 0;
+	int stats = 0;
+	size_t i;
+	MixerDevice * md;
+
+	if((queries = malloc(sizeof(*queries) * argc)) == NULL)
+		return _query_error(progname, "malloc", 2);
+	while((o = getopt(argc, argv, "d:q:r:s")) != -1)
+		switch(o)
+		{
+			case 'd':
+				device = optarg;
+				break;
+			case 'q':
+				queries[queries_cnt++] = optarg;
+				break;
+			case 'r':
+				mixerdevice_set_trace(optarg);
+				break;
+			case 's':
+				stats = 1;
+				break;
+			default:
+				free(queries);
+				return -1;
+		}
+	/* the remaining arguments are queries as well */
+	for(; optind < argc; optind++)
+		queries[queries_cnt++] = argv[optind];
+	if(queries_cnt == 0)
+	{
+		free(queries);
+		return -1;
+	}
+	mixerdevice_set_profile(stats);
+	if((md = mixerdevice_new(device)) == NULL)
+	{
+		free(queries);
+		return _query_error(progname, device, 2);
+	}
+	for(i = 0; i < queries_cnt; i++)
+		if(_query_control(progname, md, queries[i]) != 0)
+			ret = 2;
+	if(stats)
+		mixerdevice_print_stats(md, stderr);
+	mixerdevice_delete(md);
+	free(queries);
+	return ret;
+}
+
+static int _query_control(char const * progname, MixerDevice * device,
+		char const * query)
+{
+	int ret;
+	char * name;
+	char * value;
+	size_t position;
+	MixerDeviceInfo const * info;
+	MixerValue mv;
+	char const * error = NULL;
+
+	if((name = strdup(query)) == NULL)
+		return -_query_error(progname, "strdup", 1);
+	if((value = strchr(name, '=')) != NULL)
+		*(value++) = '\0';
+	if(mixerdevice_lookup(device, name, &position) != 0)
+	{
+		free(name);
+		return -_query_error(progname, query, 1);
+	}
+	info = mixerdevice_get_info(device, position);
+	/* the current value tells the number of channels */
+	if((ret = mixerdevice_get_value(device, position, &mv, &error)) == 0
+			&& value != NULL)
+	{
+		if(_query_parse(info, value, &mv) != 0)
+			error = query;
+		else
+			ret = mixerdevice_set_value(device, position, &mv,
+					&error);
+	}
+	else if(ret == 0)
+		_query_print(name, info, &mv);
+	free(name);
+	if(ret != 0)
+		errno = -ret;
+	if(ret != 0 || error != NULL)
+		return -_query_error(progname, error, 1);
+	return 0;
+}
+
+static int _query_error(char const * progname, char const * message,
+		int ret)
+{
+	fprintf(stderr, "%s: ", progname);
+	perror(message);
+	return ret;
+}
+
+static int _query_parse(MixerDeviceInfo const * info, char const * string,
+		MixerValue * value)
+{
+	size_t i;
+	size_t len;
+	unsigned long level;
+	char * p;
+
+	switch(info->type)
+	{
+		case MDT_ENUM:
+			for(i = 0; i < info->members_cnt; i++)
+				if(strcmp(info->members[i].name, string) == 0)
+				{
+					value->ord = info->members[i].value;
+					return 0;
+				}
+			break;
+		case MDT_SET:
+			/* a list of members, possibly empty */
+			for(value->mask = 0; *string != '\0'; string += len)
+			{
+				len = strcspn(string, ",");
+				for(i = 0; i < info->members_cnt; i++)
+					if(strlen(info->members[i].name) == len
+							&& strncmp(
+							info->members[i].name,
+							string, len) == 0)
+						break;
+				if(i == info->members_cnt)
+					break;
+				value->mask |= info->members[i].value;
+				if(string[len] == ',')
+					len++;
+			}
+			if(*string == '\0')
+				return 0;
+			break;
+		case MDT_VALUE:
+			/* the last level applies to the remaining channels */
+			for(i = 0; i < value->level.channels_cnt; i++)
+			{
+				if((level = strtoul(string, &p, 10)) > 100
+						|| p == string)
+					break;
+				value->level.channels[i] = level;
+				if(*p == '\0')
+				{
+					while(++i < value->level.channels_cnt)
+						value->level.channels[i] = level;
+					return 0;
+				}
+				if(*p != ',')
+					break;
+				string = p + 1;
+			}
+			break;
+		default:
+			break;
+	}
+	errno = EINVAL;
+	return -1;
+}
+
+static void _query_print(char const * name, MixerDeviceInfo const * info,
+		MixerValue const * value)
+{
+	size_t i;
+	char const * sep = "";
+
+	printf("%s=", name);
+	switch(info->type)
+	{
+		case MDT_ENUM:
+			for(i = 0; i < info->members_cnt; i++)
+				if(info->members[i].value == value->ord)
+				{
+					fputs(info->members[i].name, stdout);
+					break;
+				}
+			break;
+		case MDT_SET:
+			for(i = 0; i < info->members_cnt; i++)
+				if(value->mask & info->members[i].value)
+				{
+					printf("%s%s", sep,
+							info->members[i].name);
+					sep = ",";
+				}
+			break;
+		default:
+			for(i = 0; i < value->level.channels_cnt; i++)
+			{
+				printf("%s%u", sep, value->level.channels[i]);
+				sep = ",";
+			}
+			break;
+	}
+	putchar('\n');
+}
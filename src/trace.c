@@ -0,0 +1,377 @@
+/* $Id$ */
+/* Copyright (c) 2020 Pierre Pronchery <khorben@defora.org> */
+/* This file is part of DeforaOS Desktop Mixer */
+/* All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include "trace.h"
+
+/* compatibility */
+#ifndef EFTYPE
+# define EFTYPE	EINVAL
+#endif
+
+
+/* MixerTrace */
+/* private */
+/* constants */
+/* the integers are stored in little endian, the strings with their length */
+static const char _mixertrace_magic[4] = { 'M', 'I', 'X', 'T' };
+#define MIXERTRACE_VERSION	1
+
+
+/* prototypes */
+static int _mixertrace_read(FILE * fp, void * buf, size_t size);
+static int _mixertrace_read_string(FILE * fp, char * string, size_t size);
+static int _mixertrace_read_u8(FILE * fp, uint8_t * u8);
+static int _mixertrace_read_u32(FILE * fp, uint32_t * u32);
+
+static int _mixertrace_write(FILE * fp, void const * buf, size_t size);
+static int _mixertrace_write_string(FILE * fp, char const * string);
+static int _mixertrace_write_u8(FILE * fp, uint8_t u8);
+static int _mixertrace_write_u32(FILE * fp, uint32_t u32);
+
+
+/* public */
+/* functions */
+/* mixertrace_read_header */
+int mixertrace_read_header(FILE * fp)
+{
+	char magic[sizeof(_mixertrace_magic)];
+	uint32_t version;
+
+	if(_mixertrace_read(fp, magic, sizeof(magic)) != 0
+			|| _mixertrace_read_u32(fp, &version) != 0)
+		return -1;
+	if(memcmp(magic, _mixertrace_magic, sizeof(magic)) != 0
+			|| version != MIXERTRACE_VERSION)
+	{
+		errno = EFTYPE;
+		return -1;
+	}
+	return 0;
+}
+
+
+/* mixertrace_read_record */
+static int _read_record_info(FILE * fp, MixerDeviceInfo * info);
+static int _read_record_properties(FILE * fp, MixerProperties * properties);
+static int _read_record_value(FILE * fp, MixerTraceRecord * record,
+		MixerValue * value);
+
+int mixertrace_read_record(FILE * fp, MixerTraceRecord * record,
+		MixerTraceData * data)
+{
+	int c;
+	uint32_t u32;
+
+	if((c = fgetc(fp)) == EOF)
+		return ferror(fp) ? -1 : 1;
+	if(c > MTT_LAST)
+	{
+		errno = EFTYPE;
+		return -1;
+	}
+	record->type = c;
+	record->level = 0;
+	if(_mixertrace_read_u32(fp, &record->position) != 0
+			|| _mixertrace_read_u32(fp, &u32) != 0
+			|| _mixertrace_read_u32(fp, &record->duration) != 0)
+		return -1;
+	record->ret = (int32_t)u32;
+	if(record->ret != 0 || record->type == MTT_MODIFIED
+			|| record->type == MTT_CHANGED)
+		return 0;
+	switch(record->type)
+	{
+		case MTT_INFO:
+			return _read_record_info(fp, &data->info);
+		case MTT_PROPERTIES:
+			return _read_record_properties(fp, &data->properties);
+		default:
+			return _read_record_value(fp, record, &data->value);
+	}
+}
+
+static int _read_record_info(FILE * fp, MixerDeviceInfo * info)
+{
+	uint8_t u8;
+	uint32_t u32;
+	size_t i;
+
+	memset(info, 0, sizeof(*info));
+	if(_mixertrace_read_u8(fp, &u8) != 0
+			|| _mixertrace_read_u32(fp, &u32) != 0
+			|| _mixertrace_read_string(fp, info->name,
+				sizeof(info->name)) != 0
+			|| _mixertrace_read_string(fp, info->label,
+				sizeof(info->label)) != 0)
+		return -1;
+	info->type = u8;
+	info->mixer_class = (int32_t)u32;
+	if(_mixertrace_read_u8(fp, &u8) != 0)
+		return -1;
+	if(info->type > MDT_VALUE || u8 > sizeof(info->members)
+			/ sizeof(*info->members))
+	{
+		errno = EFTYPE;
+		return -1;
+	}
+	info->members_cnt = u8;
+	for(i = 0; i < info->members_cnt; i++)
+	{
+		if(_mixertrace_read_string(fp, info->members[i].name,
+					sizeof(info->members[i].name)) != 0
+				|| _mixertrace_read_u32(fp, &u32) != 0)
+			return -1;
+		info->members[i].value = (int32_t)u32;
+	}
+	if(_mixertrace_read_u8(fp, &u8) != 0
+			|| _mixertrace_read_u8(fp, &info->delta) != 0)
+		return -1;
+	info->channels_cnt = u8;
+	return 0;
+}
+
+static int _read_record_properties(FILE * fp, MixerProperties * properties)
+{
+	memset(properties, 0, sizeof(*properties));
+	return (_mixertrace_read_string(fp, properties->name,
+				sizeof(properties->name)) != 0
+			|| _mixertrace_read_string(fp, properties->version,
+				sizeof(properties->version)) != 0
+			|| _mixertrace_read_string(fp, properties->device,
+				sizeof(properties->device)) != 0) ? -1 : 0;
+}
+
+static int _read_record_value(FILE * fp, MixerTraceRecord * record,
+		MixerValue * value)
+{
+	uint8_t u8;
+	uint32_t u32;
+
+	memset(value, 0, sizeof(*value));
+	if(_mixertrace_read_u8(fp, &u8) != 0)
+		return -1;
+	if((record->level = u8) == 0)
+	{
+		if(_mixertrace_read_u32(fp, &u32) != 0)
+			return -1;
+		value->ord = (int32_t)u32;
+		return 0;
+	}
+	if(_mixertrace_read_u8(fp, &u8) != 0
+			|| _mixertrace_read_u8(fp, &value->level.delta) != 0)
+		return -1;
+	if(u8 > sizeof(value->level.channels))
+	{
+		errno = EFTYPE;
+		return -1;
+	}
+	value->level.channels_cnt = u8;
+	return _mixertrace_read(fp, value->level.channels,
+			value->level.channels_cnt);
+}
+
+
+/* mixertrace_write_header */
+int mixertrace_write_header(FILE * fp)
+{
+	return (_mixertrace_write(fp, _mixertrace_magic,
+				sizeof(_mixertrace_magic)) != 0
+			|| _mixertrace_write_u32(fp, MIXERTRACE_VERSION) != 0)
+		? -1 : 0;
+}
+
+
+/* mixertrace_write_record */
+static int _write_record_info(FILE * fp, MixerDeviceInfo const * info);
+static int _write_record_properties(FILE * fp,
+		MixerProperties const * properties);
+static int _write_record_value(FILE * fp, MixerTraceRecord const * record,
+		MixerValue const * value);
+
+int mixertrace_write_record(FILE * fp, MixerTraceRecord const * record,
+		MixerTraceData const * data)
+{
+	if(_mixertrace_write_u8(fp, record->type) != 0
+			|| _mixertrace_write_u32(fp, record->position) != 0
+			|| _mixertrace_write_u32(fp, (uint32_t)record->ret)
+			!= 0
+			|| _mixertrace_write_u32(fp, record->duration) != 0)
+		return -1;
+	if(record->ret != 0 || record->type == MTT_MODIFIED
+			|| record->type == MTT_CHANGED)
+		return 0;
+	switch(record->type)
+	{
+		case MTT_INFO:
+			return _write_record_info(fp, &data->info);
+		case MTT_PROPERTIES:
+			return _write_record_properties(fp, &data->properties);
+		default:
+			return _write_record_value(fp, record, &data->value);
+	}
+}
+
+static int _write_record_info(FILE * fp, MixerDeviceInfo const * info)
+{
+	size_t i;
+
+	if(_mixertrace_write_u8(fp, info->type) != 0
+			|| _mixertrace_write_u32(fp, (uint32_t)info->mixer_class)
+			!= 0
+			|| _mixertrace_write_string(fp, info->name) != 0
+			|| _mixertrace_write_string(fp, info->label) != 0
+			|| _mixertrace_write_u8(fp, info->members_cnt) != 0)
+		return -1;
+	for(i = 0; i < info->members_cnt; i++)
+		if(_mixertrace_write_string(fp, info->members[i].name) != 0
+				|| _mixertrace_write_u32(fp, (uint32_t)
+					info->members[i].value) != 0)
+			return -1;
+	return (_mixertrace_write_u8(fp, info->channels_cnt) != 0
+			|| _mixertrace_write_u8(fp, info->delta) != 0) ? -1 : 0;
+}
+
+static int _write_record_properties(FILE * fp,
+		MixerProperties const * properties)
+{
+	return (_mixertrace_write_string(fp, properties->name) != 0
+			|| _mixertrace_write_string(fp, properties->version)
+			!= 0
+			|| _mixertrace_write_string(fp, properties->device)
+			!= 0) ? -1 : 0;
+}
+
+static int _write_record_value(FILE * fp, MixerTraceRecord const * record,
+		MixerValue const * value)
+{
+	if(_mixertrace_write_u8(fp, record->level ? 1 : 0) != 0)
+		return -1;
+	if(!record->level)
+		return _mixertrace_write_u32(fp, (uint32_t)value->ord);
+	return (_mixertrace_write_u8(fp, value->level.channels_cnt) != 0
+			|| _mixertrace_write_u8(fp, value->level.delta) != 0
+			|| _mixertrace_write(fp, value->level.channels,
+				value->level.channels_cnt) != 0) ? -1 : 0;
+}
+
+
+/* private */
+/* functions */
+/* mixertrace_read */
+static int _mixertrace_read(FILE * fp, void * buf, size_t size)
+{
+	if(size == 0 || fread(buf, size, 1, fp) == 1)
+		return 0;
+	/* the trace is truncated */
+	if(!ferror(fp))
+		errno = EFTYPE;
+	return -1;
+}
+
+
+/* mixertrace_read_string */
+static int _mixertrace_read_string(FILE * fp, char * string, size_t size)
+{
+	uint8_t len;
+
+	if(_mixertrace_read_u8(fp, &len) != 0)
+		return -1;
+	if(len >= size)
+	{
+		errno = EFTYPE;
+		return -1;
+	}
+	string[len] = '\0';
+	return _mixertrace_read(fp, string, len);
+}
+
+
+/* mixertrace_read_u8 */
+static int _mixertrace_read_u8(FILE * fp, uint8_t * u8)
+{
+	return _mixertrace_read(fp, u8, sizeof(*u8));
+}
+
+
+/* mixertrace_read_u32 */
+static int _mixertrace_read_u32(FILE * fp, uint32_t * u32)
+{
+	unsigned char buf[4];
+
+	if(_mixertrace_read(fp, buf, sizeof(buf)) != 0)
+		return -1;
+	*u32 = buf[0] | (buf[1] << 8) | (buf[2] << 16)
+		| ((uint32_t)buf[3] << 24);
+	return 0;
+}
+
+
+/* mixertrace_write */
+static int _mixertrace_write(FILE * fp, void const * buf, size_t size)
+{
+	return (size == 0 || fwrite(buf, size, 1, fp) == 1) ? 0 : -1;
+}
+
+
+/* mixertrace_write_string */
+static int _mixertrace_write_string(FILE * fp, char const * string)
+{
+	size_t len;
+
+	/* the strings come from fixed-size buffers */
+	if((len = strlen(string)) > 255)
+		len = 255;
+	return (_mixertrace_write_u8(fp, len) != 0
+			|| _mixertrace_write(fp, string, len) != 0) ? -1 : 0;
+}
+
+
+/* mixertrace_write_u8 */
+static int _mixertrace_write_u8(FILE * fp, uint8_t u8)
+{
+	return _mixertrace_write(fp, &u8, sizeof(u8));
+}
+
+
+/* mixertrace_write_u32 */
+static int _mixertrace_write_u32(FILE * fp, uint32_t u32)
+{
+	unsigned char buf[4];
+
+	buf[0] = u32 & 0xff;
+	buf[1] = (u32 >> 8) & 0xff;
+	buf[2] = (u32 >> 16) & 0xff;
+	buf[3] = (u32 >> 24) & 0xff;
+	return _mixertrace_write(fp, buf, sizeof(buf));
+}
@@ -0,0 +1,85 @@
+/* $Id$ */
+/* Copyright (c) 2020 Pierre Pronchery <khorben@defora.org> */
+/* This file is part of DeforaOS Desktop Mixer */
+/* All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+
+#ifndef MIXER_TRACE_H
+# define MIXER_TRACE_H
+
+# include <stdio.h>
+# include "device.h"
+
+
+/* MixerTrace */
+/* types */
+typedef enum _MixerTraceType
+{
+	MTT_INFO = 0,
+	MTT_PROPERTIES,
+	MTT_MODIFIED,
+	MTT_READ,
+	MTT_WRITE,
+	MTT_CHANGED
+} MixerTraceType;
+# define MTT_LAST MTT_CHANGED
+# define MTT_COUNT (MTT_LAST + 1)
+
+typedef struct _MixerTraceRecord
+{
+	MixerTraceType type;
+	uint32_t position;
+	/* the value returned, or the modification flag for MTT_MODIFIED and
+	 * MTT_CHANGED */
+	int32_t ret;
+	/* in microseconds */
+	uint32_t duration;
+	/* MTT_READ and MTT_WRITE: the value holds a level */
+	int level;
+} MixerTraceRecord;
+
+/* the payload, only present when the call succeeded */
+typedef union _MixerTraceData
+{
+	MixerDeviceInfo info;
+	MixerProperties properties;
+	MixerValue value;
+} MixerTraceData;
+
+
+/* functions */
+/* these return 0 upon success, or -1 and set errno */
+int mixertrace_read_header(FILE * fp);
+/* returns 1 at the end of the trace */
+int mixertrace_read_record(FILE * fp, MixerTraceRecord * record,
+		MixerTraceData * data);
+
+int mixertrace_write_header(FILE * fp);
+int mixertrace_write_record(FILE * fp, MixerTraceRecord const * record,
+		MixerTraceData const * data);
+
+#endif /* !MIXER_TRACE_H */
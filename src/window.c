@@ -429,6 +429,13 @@ static gboolean _about_on_closex(GtkWidget * widget)
 }
 
 
+/* mixerwindow_print_stats */
+void mixerwindow_print_stats(MixerWindow * mixer, FILE * fp)
+{
+	mixer_print_stats(mixer->mixer, fp);
+}
+
+
 /* mixerwindow_properties */
 void mixerwindow_properties(MixerWindow * mixer)
 {
@@ -51,6 +51,7 @@ void mixerwindow_set_fullscreen(MixerWindow * mixer, gboolean fullscreen);
 
 /* useful */
 void mixerwindow_about(MixerWindow * mixer);
+void mixerwindow_print_stats(MixerWindow * mixer, FILE * fp);
 void mixerwindow_properties(MixerWindow * mixer);
 
 void mixerwindow_show(MixerWindow * mixer);
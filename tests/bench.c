@@ -0,0 +1,562 @@
+/* $Id$ */
+/* Copyright (c) 2020 Pierre Pronchery <khorben@defora.org> */
+/* This file is part of DeforaOS Desktop Mixer */
+/* All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS
+ * IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE /* for RTLD_NEXT */
+#endif
+#include <dlfcn.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#ifdef __GLIBC__
+# include <malloc.h>
+#endif
+#include <gtk/gtk.h>
+#include "../src/mixer.h"
+#include "../config.h"
+
+
+/* constants */
+#ifndef PROGNAME_BENCH
+# define PROGNAME_BENCH	"bench"
+#endif
+
+
+/* bench */
+/* private */
+/* types */
+typedef struct _BenchSample
+{
+	uint64_t time;
+	unsigned long allocs;
+	unsigned long bytes;
+	MixerStats stats;
+} BenchSample;
+
+
+/* prototypes */
+static int _bench(char const * device, unsigned int controls,
+		unsigned int iterations);
+static int _bench_changes(unsigned int controls, unsigned int changes,
+		unsigned int iterations);
+static int _bench_device(char const * device, unsigned int iterations);
+static void _bench_drain(Mixer * mixer);
+static unsigned long _bench_heap(void);
+static void _bench_layout(Mixer * mixer, unsigned int controls,
+		BenchSample * before, BenchSample * after);
+static void _bench_print(char const * name, unsigned int controls,
+		unsigned long count, BenchSample * before, BenchSample * after,
+		gboolean ioctls);
+static void _bench_sample(Mixer * mixer, BenchSample * sample);
+
+static int _usage(void);
+
+/* allocations, as interposed by the executable */
+static void _bench_alloc_init(void);
+static void * _bench_alloc_early(size_t size);
+
+
+/* variables */
+/* the allocations from the libraries are accounted for as well */
+static volatile gsize _bench_allocs = 0;
+static volatile gsize _bench_bytes = 0;
+
+static void * (*_bench_calloc)(size_t nmemb, size_t size) = NULL;
+static void * (*_bench_malloc)(size_t size) = NULL;
+static void * (*_bench_realloc)(void * ptr, size_t size) = NULL;
+static void (*_bench_free)(void * ptr) = NULL;
+
+/* for the allocations while looking up the functions above */
+static char _bench_early[4096];
+static size_t _bench_early_cnt = 0;
+
+
+/* functions */
+/* bench */
+static void _bench_refresh(Mixer * mixer);
+
+static int _bench(char const * device, unsigned int controls,
+		unsigned int iterations)
+{
+	GtkWidget * window;
+	Mixer * mixer;
+	MixerControl * control;
+	BenchSample before;
+	BenchSample after;
+	unsigned int i;
+	unsigned int channels;
+	uint8_t levels[2][MIXERDEVICE_CHANNELS_MAX];
+	char id[32];
+
+	window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+	/* startup */
+	_bench_sample(NULL, &before);
+	if((mixer = mixer_new(window, device, ML_HORIZONTAL)) == NULL)
+	{
+		gtk_widget_destroy(window);
+		return -1;
+	}
+	_bench_sample(mixer, &after);
+	_bench_print("new", controls, 1, &before, &after, TRUE);
+	_bench_layout(mixer, controls, &before, &after);
+	/* refresh, every class being visible */
+	mixer_show_all(mixer);
+	_bench_sample(mixer, &before);
+	for(i = 0; i < iterations; i++)
+		_bench_refresh(mixer);
+	_bench_sample(mixer, &after);
+	/* only the controls actually read are accounted for */
+	_bench_print("refresh", controls, MAX(after.stats.reads
+				- before.stats.reads, 1), &before, &after,
+			TRUE);
+	/* set, as when dragging a control without coalescing: the last one
+	 * simulated, as the controls are looked up by position */
+	snprintf(id, sizeof(id), "control%u", (controls - 1) & ~1u);
+	if((control = mixer_get_control(mixer, id)) != NULL
+			&& mixercontrol_get_property(control, MCP_CHANNELS,
+				&channels) == 0
+			&& channels <= MIXERDEVICE_CHANNELS_MAX)
+	{
+		/* the levels are only written when changed */
+		memset(levels[0], 0x40, sizeof(levels[0]));
+		memset(levels[1], 0xc0, sizeof(levels[1]));
+		mixer_set_write_interval(mixer, 0);
+		_bench_drain(mixer);
+		_bench_sample(mixer, &before);
+		for(i = 0; i < iterations; i++)
+		{
+			mixercontrol_set_levels(control, levels[i % 2],
+					channels);
+			mixer_set(mixer, control);
+		}
+		/* until the levels are actually written to the device */
+		_bench_drain(mixer);
+		_bench_sample(mixer, &after);
+		_bench_print("set", controls, iterations, &before, &after,
+				TRUE);
+	}
+	while(gtk_events_pending())
+		gtk_main_iteration();
+	mixer_delete(mixer);
+	gtk_widget_destroy(window);
+	return 0;
+}
+
+static void _bench_refresh(Mixer * mixer)
+{
+	MixerStats stats;
+	unsigned long refreshes;
+
+	mixer_get_stats(mixer, &stats);
+	refreshes = stats.refreshes;
+	mixer_refresh(mixer);
+	/* the refresh may complete asynchronously */
+	for(mixer_get_stats(mixer, &stats); stats.refreshes == refreshes;
+			mixer_get_stats(mixer, &stats))
+		g_main_context_iteration(NULL, TRUE);
+}
+
+
+/* bench_changes */
+static int _bench_changes(unsigned int controls, unsigned int changes,
+		unsigned int iterations)
+{
+	int ret = 0;
+	char buf[64];
+	GtkWidget * window;
+	Mixer * mixer;
+	BenchSample before;
+	BenchSample after;
+	unsigned long refreshes;
+	unsigned long reads;
+	unsigned int i;
+
+	snprintf(buf, sizeof(buf), "sim:controls=%u,counter=1,updates=1"
+			",changes=%u", controls, changes);
+	window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+	if((mixer = mixer_new(window, buf, ML_HORIZONTAL)) == NULL)
+	{
+		gtk_widget_destroy(window);
+		return -1;
+	}
+	mixer_show_all(mixer);
+	/* once every control was read first */
+	_bench_refresh(mixer);
+	_bench_refresh(mixer);
+	_bench_sample(mixer, &before);
+	for(i = 0; i < iterations; i++)
+		_bench_refresh(mixer);
+	_bench_sample(mixer, &after);
+	refreshes = after.stats.refreshes - before.stats.refreshes;
+	reads = after.stats.reads - before.stats.reads;
+	_bench_print("changes", controls, MAX(reads, 1), &before, &after,
+			TRUE);
+	/* every control is visible, but only those changed are read */
+	if(reads != refreshes * changes)
+	{
+		fprintf(stderr, PROGNAME_BENCH ": %lu controls read instead of"
+				" %lu\n", reads, refreshes * changes);
+		ret = -1;
+	}
+	while(gtk_events_pending())
+		gtk_main_iteration();
+	mixer_delete(mixer);
+	gtk_widget_destroy(window);
+	return ret;
+}
+
+
+/* bench_device */
+static int _bench_device(char const * device, unsigned int iterations)
+{
+	MixerDevice * md;
+	size_t cnt;
+	size_t i;
+	unsigned int controls = 0;
+
+	/* count the controls, as a trace being replayed for instance */
+	if((md = mixerdevice_new(device)) == NULL)
+	{
+		fputs(PROGNAME_BENCH ": ", stderr);
+		perror(device);
+		return -1;
+	}
+	for(i = 0, cnt = mixerdevice_get_count(md); i < cnt; i++)
+		if(mixerdevice_get_info(md, i)->type != MDT_CLASS)
+			controls++;
+	mixerdevice_delete(md);
+	return _bench(device, controls, iterations);
+}
+
+
+/* bench_drain */
+static void _bench_drain(Mixer * mixer)
+{
+	MixerStats stats;
+	unsigned long ioctls;
+
+	/* the device is no longer accessed once the thread is idle */
+	mixer_get_stats(mixer, &stats);
+	do
+	{
+		ioctls = stats.ioctls;
+		while(gtk_events_pending())
+			gtk_main_iteration();
+		g_usleep(1000);
+		while(gtk_events_pending())
+			gtk_main_iteration();
+		mixer_get_stats(mixer, &stats);
+	}
+	while(stats.ioctls != ioctls);
+}
+
+
+/* bench_heap */
+static unsigned long _bench_heap(void)
+{
+#if defined(__GLIBC__) && __GLIBC_PREREQ(2, 33)
+	struct mallinfo2 mi;
+
+	/* in use, including the large allocations mapped on their own */
+	mi = mallinfo2();
+	return mi.uordblks + mi.hblkhd;
+#else
+	/* every byte allocated, as the heap cannot be inspected */
+	return (unsigned long)g_atomic_pointer_get(&_bench_bytes);
+#endif
+}
+
+
+/* bench_layout */
+static void _bench_layout_count(GtkWidget * widget, gpointer data);
+
+static void _bench_layout(Mixer * mixer, unsigned int controls,
+		BenchSample * before, BenchSample * after)
+{
+	GtkWidget * widget;
+	GtkRequisition requisition;
+	unsigned long widgets = 0;
+	BenchSample start;
+	BenchSample end;
+
+	widget = mixer_get_widget(mixer);
+	_bench_layout_count(widget, &widgets);
+	/* the first size request lays out every control */
+	_bench_sample(mixer, &start);
+#if GTK_CHECK_VERSION(3, 0, 0)
+	gtk_widget_get_preferred_size(widget, &requisition, NULL);
+#else
+	gtk_widget_size_request(widget, &requisition);
+#endif
+	_bench_sample(mixer, &end);
+	printf("bench=layout controls=%u count=1 ns=%lu widgets=%lu"
+			" widgets/control=%.2f bytes/control=%.1f\n", controls,
+			(unsigned long)(end.time - start.time), widgets,
+			(double)widgets / controls,
+			((double)after->bytes - before->bytes) / controls);
+}
+
+static void _bench_layout_count(GtkWidget * widget, gpointer data)
+{
+	unsigned long * widgets = data;
+
+	(*widgets)++;
+	if(GTK_IS_CONTAINER(widget))
+		gtk_container_forall(GTK_CONTAINER(widget),
+				_bench_layout_count, data);
+}
+
+
+/* bench_print */
+static void _bench_print(char const * name, unsigned int controls,
+		unsigned long count, BenchSample * before, BenchSample * after,
+		gboolean ioctls)
+{
+	printf("bench=%s controls=%u count=%lu ns=%.1f allocs=%.2f", name,
+			controls, count, (double)(after->time - before->time)
+			/ count, (double)(after->allocs - before->allocs)
+			/ count);
+	if(ioctls)
+		printf(" ioctls=%.2f", (double)(after->stats.ioctls
+					- before->stats.ioctls) / count);
+	printf(" plugins=%lu writes=%lu coalesced=%lu\n",
+			after->stats.plugins - before->stats.plugins,
+			after->stats.writes - before->stats.writes,
+			after->stats.writes_coalesced
+			- before->stats.writes_coalesced);
+}
+
+
+/* bench_sample */
+static void _bench_sample(Mixer * mixer, BenchSample * sample)
+{
+	struct timespec ts;
+
+	if(mixer != NULL)
+		mixer_get_stats(mixer, &sample->stats);
+	else
+	{
+		memset(&sample->stats, 0, sizeof(sample->stats));
+		sample->stats.plugins = mixercontrol_get_loaded();
+	}
+	sample->allocs = (unsigned long)g_atomic_pointer_get(&_bench_allocs);
+	sample->bytes = _bench_heap();
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	sample->time = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+
+/* usage */
+static int _usage(void)
+{
+	fputs("Usage: " PROGNAME_BENCH " [-m][-n iterations][controls...]\n"
+"       " PROGNAME_BENCH " [-m][-n iterations] -d device\n"
+"  -d	Mixer device to use instead of a simulated one\n"
+"  -m	Show the levels as meters\n"
+"  -n	Number of iterations for each operation (default: 100)\n",
+			stderr);
+	return 1;
+}
+
+
+/* allocations */
+/* bench_alloc_init */
+static void _bench_alloc_init(void)
+{
+	static int resolving = 0;
+
+	if(resolving)
+		return;
+	resolving = 1;
+	_bench_calloc = dlsym(RTLD_NEXT, "calloc");
+	_bench_malloc = dlsym(RTLD_NEXT, "malloc");
+	_bench_realloc = dlsym(RTLD_NEXT, "realloc");
+	_bench_free = dlsym(RTLD_NEXT, "free");
+	resolving = 0;
+}
+
+
+/* bench_alloc_early */
+static void * _bench_alloc_early(size_t size)
+{
+	void * ret;
+
+	/* keep the alignment of malloc() */
+	size = (size + 15) & ~(size_t)15;
+	if(size > sizeof(_bench_early) - _bench_early_cnt)
+		return NULL;
+	ret = &_bench_early[_bench_early_cnt];
+	_bench_early_cnt += size;
+	return ret;
+}
+
+
+/* calloc */
+void * calloc(size_t nmemb, size_t size)
+{
+	if(_bench_calloc == NULL)
+		_bench_alloc_init();
+	g_atomic_pointer_add(&_bench_allocs, 1);
+	g_atomic_pointer_add(&_bench_bytes, nmemb * size);
+	if(_bench_calloc == NULL)
+		/* already zeroed */
+		return (nmemb != 0 && size > SIZE_MAX / nmemb) ? NULL
+			: _bench_alloc_early(nmemb * size);
+	return _bench_calloc(nmemb, size);
+}
+
+
+/* free */
+void free(void * ptr)
+{
+	if((char *)ptr >= _bench_early
+			&& (char *)ptr < &_bench_early[sizeof(_bench_early)])
+		return;
+	if(_bench_free == NULL)
+		_bench_alloc_init();
+	if(_bench_free != NULL)
+		_bench_free(ptr);
+}
+
+
+/* malloc */
+void * malloc(size_t size)
+{
+	if(_bench_malloc == NULL)
+		_bench_alloc_init();
+	g_atomic_pointer_add(&_bench_allocs, 1);
+	g_atomic_pointer_add(&_bench_bytes, size);
+	if(_bench_malloc == NULL)
+		return _bench_alloc_early(size);
+	return _bench_malloc(size);
+}
+
+
+/* realloc */
+void * realloc(void * ptr, size_t size)
+{
+	void * ret;
+	size_t cnt;
+
+	if(_bench_realloc == NULL)
+		_bench_alloc_init();
+	if((char *)ptr >= _bench_early
+			&& (char *)ptr < &_bench_early[sizeof(_bench_early)])
+	{
+		/* moved out of the early allocations */
+		if((ret = malloc(size)) != NULL)
+		{
+			cnt = &_bench_early[sizeof(_bench_early)] - (char *)ptr;
+			memcpy(ret, ptr, (size < cnt) ? size : cnt);
+		}
+		return ret;
+	}
+	g_atomic_pointer_add(&_bench_allocs, 1);
+	g_atomic_pointer_add(&_bench_bytes, size);
+	if(_bench_realloc == NULL)
+		return (ptr == NULL) ? _bench_alloc_early(size) : NULL;
+	return _bench_realloc(ptr, size);
+}
+
+
+/* public */
+/* functions */
+/* main */
+int main(int argc, char * argv[])
+{
+	int ret = 0;
+	int o;
+	unsigned int iterations = 100;
+	unsigned int controls[] = { 10, 100, 1000 };
+	char const * device = NULL;
+	char buf[64];
+	size_t i;
+	char * p;
+	unsigned long u;
+
+#ifdef M_ARENA_MAX
+	/* mallinfo2() only covers the main arena */
+	mallopt(M_ARENA_MAX, 1);
+#endif
+	/* for the heap to reflect every allocation of GLib */
+	setenv("G_SLICE", "always-malloc", 1);
+	if(gtk_init_check(&argc, &argv) != TRUE)
+	{
+		fputs(PROGNAME_BENCH ": Could not initialize Gtk+\n", stderr);
+		return 2;
+	}
+	while((o = getopt(argc, argv, "d:mn:")) != -1)
+		switch(o)
+		{
+			case 'd':
+				device = optarg;
+				break;
+			case 'm':
+				mixer_set_meters(TRUE);
+				break;
+			case 'n':
+				u = strtoul(optarg, &p, 10);
+				if(optarg[0] == '\0' || *p != '\0' || u == 0)
+					return _usage();
+				iterations = u;
+				break;
+			default:
+				return _usage();
+		}
+	if(device != NULL)
+	{
+		if(optind != argc)
+			return _usage();
+		return (_bench_device(device, iterations) == 0) ? 0 : 2;
+	}
+	/* the controls are always probed when refreshing */
+	if(optind == argc)
+	{
+		for(i = 0; i < sizeof(controls) / sizeof(*controls); i++)
+		{
+			snprintf(buf, sizeof(buf), "sim:controls=%u,counter=0"
+					",updates=0", controls[i]);
+			ret |= _bench(buf, controls[i], iterations);
+		}
+		ret |= _bench_changes(100, 10, iterations);
+	}
+	for(; optind < argc; optind++)
+	{
+		u = strtoul(argv[optind], &p, 10);
+		if(argv[optind][0] == '\0' || *p != '\0' || u == 0)
+			return _usage();
+		snprintf(buf, sizeof(buf), "sim:controls=%lu,counter=0"
+				",updates=0", u);
+		ret |= _bench(buf, u, iterations);
+	}
+	return (ret == 0) ? 0 : 2;
+}